@@ -176,8 +176,8 @@ char* SecondAlloc::_chunk_alloc(size_t block_size, size_t& nblocks) {
 // 默认为一级内存分配器
 template <class Type, class Alloc = FirstAlloc>
 struct Allocator {
-    // 分配nobjs个Type类对象的空间【对应malloc()】
-    static Type* allocate(size_t nobjs) 
+    // 分配nobjs个Type类对象的空间【对应malloc()】，缺省1个即与二级内存分配器的接口一致，链式结构可任选其一
+    static Type* allocate(size_t nobjs = 1) 
         { return (Type*)Alloc::allocate(nobjs*sizeof(Type)); }
     // 释放mem所指空间【对应free()】
     static void deallocate(Type* mem)
@@ -0,0 +1,151 @@
+/* bloom_filter.hpp
+ * 【布隆过滤器】判断一个键“一定不存在”还是“可能存在”，挡在哈希表/树/磁盘结构前面，把大多数不命中的查找提前拒掉
+ * 参考Putze等人的blocked Bloom filter，以及Impala/Parquet的split block Bloom filter
+ *
+ * 结构：
+ * (1)位数组切成若干个256位（32字节，半条缓存行）的块，每个键只落在一个块里，插入/查询只碰一条缓存行
+ * (2)块内分成8个32位的字，键在每个字里各置1位：第i位 = (key32 * salt[i]) >> 27，8个字互不干扰
+ * (3)有AVX2时8个字用一条256位指令并行算出掩码、一次vptest检查，没有时逐字计算（编译器也会自动向量化）
+ * (4)每键10位时误判率约1%，每键16位时约0.1%
+ *
+ * 注意：
+ * 不能删除！erase()什么也不做，只是为了与CuckooFilter<>接口一致（被删的键之后可能仍判为“可能存在”，无非多查一次）
+ */
+#ifndef __BLOOM_FILTER__
+#define __BLOOM_FILTER__
+#include <iostream>
+#include <cstring>      // memset(), memcpy()
+#include <cstdint>      // uint32_t, uint64_t
+#include "alloc.hpp"
+#include "utils.hpp"
+#ifdef __AVX2__
+#include <immintrin.h>  // AVX2
+#endif
+using namespace std;
+
+
+// 256位的块
+struct __BloomBlock {
+    uint32_t words[8];
+};
+// 每个字各用一个奇数乘子把键的低32位打散
+static const uint32_t __bloom_salt[8] = {
+    0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+    0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U
+};
+
+
+// """布隆过滤器"""
+template <class Key, class KeyHasher = HashCode<Key> >
+class BloomFilter {
+
+public:     // 【类型定义】
+    typedef Key                 key_type;
+    typedef size_t              size_type;
+
+private:    // 【成员变量】
+    KeyHasher       _hasher;
+    __BloomBlock*   _blocks;
+    size_type       _n_blocks;
+    size_type       _capacity;      // 预计的键数
+    size_type       _size;          // 已插入的次数
+
+private:    // 【哈希】
+    // 自定义的HashCode<>未必混合充分（如恒等映射），再混合一次（murmur3的fmix64）
+    static uint64_t _mix(uint64_t h) {
+        h ^= h >> 33;  h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;  h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+    // 高32位选块（乘法取高位映射到[0, _n_blocks)），低32位决定块内的8个位
+    const __BloomBlock* _block_of(uint64_t h) const
+        { return _blocks + (size_type)(((h >> 32) * (uint64_t)_n_blocks) >> 32); }
+    __BloomBlock* _block_of(uint64_t h)
+        { return _blocks + (size_type)(((h >> 32) * (uint64_t)_n_blocks) >> 32); }
+#ifdef __AVX2__
+    static __m256i _mask(uint32_t key32) {
+        __m256i salt = _mm256_loadu_si256((const __m256i*)__bloom_salt);
+        __m256i bits = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_set1_epi32((int)key32), salt), 27);
+        return _mm256_sllv_epi32(_mm256_set1_epi32(1), bits);
+    }
+    static void _set(__BloomBlock* block, uint32_t key32) {
+        __m256i words = _mm256_loadu_si256((const __m256i*)block->words);
+        _mm256_storeu_si256((__m256i*)block->words, _mm256_or_si256(words, _mask(key32)));
+    }
+    static bool _test(const __BloomBlock* block, uint32_t key32) {
+        __m256i words = _mm256_loadu_si256((const __m256i*)block->words);
+        return _mm256_testc_si256(words, _mask(key32)) != 0;    // 掩码的位在words里都是1
+    }
+#else
+    static void _set(__BloomBlock* block, uint32_t key32) {
+        for (int i=0; i<8; ++i) block->words[i] |= 1U << ((key32 * __bloom_salt[i]) >> 27);
+    }
+    static bool _test(const __BloomBlock* block, uint32_t key32) {
+        uint32_t missing = 0;
+        for (int i=0; i<8; ++i) missing |= ~block->words[i] & (1U << ((key32 * __bloom_salt[i]) >> 27));
+        return missing == 0;
+    }
+#endif
+
+public:     // 【构造/析构函数】
+    // 预计存放capacity个键，每个键平均占bits_per_key位
+    explicit BloomFilter(size_type capacity = 1024, size_type bits_per_key = 10):
+        _capacity(capacity), _size(0) {
+        _n_blocks = (capacity * bits_per_key + 255) / 256;
+        if (_n_blocks == 0) _n_blocks = 1;
+        _blocks = (__BloomBlock*)FirstAlloc::clallocate(_n_blocks, sizeof(__BloomBlock));
+    }
+    BloomFilter(const BloomFilter& other):
+        _hasher(other._hasher), _n_blocks(other._n_blocks), _capacity(other._capacity), _size(other._size) {
+        _blocks = (__BloomBlock*)FirstAlloc::allocate(_n_blocks * sizeof(__BloomBlock));
+        memcpy(_blocks, other._blocks, _n_blocks * sizeof(__BloomBlock));
+    }
+    BloomFilter& operator=(const BloomFilter& other) {
+        if (this != &other) {
+            BloomFilter copy(other);
+            swap(copy);
+        }
+        return *this;
+    }
+    ~BloomFilter() { FirstAlloc::deallocate(_blocks); }
+    void swap(BloomFilter& other) {
+        std::swap(_hasher, other._hasher);      std::swap(_blocks, other._blocks);
+        std::swap(_n_blocks, other._n_blocks);  std::swap(_capacity, other._capacity);
+        std::swap(_size, other._size);
+    }
+
+public:     // 【Basic Accessor】
+    size_type size()        const { return _size; }
+    size_type capacity()    const { return _capacity; }
+    size_type bit_count()   const { return _n_blocks * 256; }
+    void clear() {
+        memset(_blocks, 0, _n_blocks * sizeof(__BloomBlock));
+        _size = 0;
+    }
+
+public:     // 【增、查、删】
+    // 总是成功，返回true【与CuckooFilter<>的接口一致】
+    bool insert(const Key& key) {
+        uint64_t h = _mix(_hasher(key));
+        _set(_block_of(h), (uint32_t)h);
+        ++_size;
+        return true;
+    }
+    // 返回false即一定不存在；返回true即可能存在
+    bool might_contain(const Key& key) const {
+        uint64_t h = _mix(_hasher(key));
+        return _test(_block_of(h), (uint32_t)h);
+    }
+    // 透明查找：KeyHasher声明了is_transparent时，可直接以const char*/StringView等查询，不构造临时Key
+    template <class K, class = typename __TransparentKey<KeyHasher, KeyHasher, K>::type>
+    bool might_contain(const K& key) const {
+        uint64_t h = _mix(_hasher(key));
+        return _test(_block_of(h), (uint32_t)h);
+    }
+    // 布隆过滤器无法删除，什么也不做
+    void erase(const Key&) {}
+};
+
+
+#endif // __BLOOM_FILTER__
@@ -0,0 +1,773 @@
+/* btree_map.hpp
+ * 【B+树映射】接口与TreeMap<>一致的有序映射，但一个节点存几十个键，对缓存友好得多
+ * 参考google的cpp-btree(absl::btree_map)以及各数据库的B+树索引
+ *
+ * 为什么比红黑树快：
+ * 红黑树每层一个节点、一次指针跳转，百万个键约20层，查找要等20次左右的cache miss；
+ * B+树一个节点约512字节（8条缓存行），扇出几十，百万个键只有4~5层，每层的节点内查找都在已读入的缓存行里完成
+ *
+ * 结构：
+ * (1)叶节点存键值对（键、值分成两个数组，键数组连续，便于节点内查找），叶节点之间双向链接，范围扫描顺着链表走
+ * (2)内部节点只存分隔键与孩子指针：孩子i的键都 < keys[i] <= 孩子i+1的键
+ * (3)节点内查找：整数键（且用缺省的Compare<>）时线性数出“比key小的键”的个数，
+ *    int用SSE2、64位整数用AVX2/SSE4.2一次比较4/2个，没有分支，也就没有分支预测失败；其余类型二分查找
+ * (4)节点来自每棵树自己的节点池：按块（64个节点）向一级分配器要内存，释放的节点挂回空闲链表
+ *    【二级内存分配器只管128字节以内的内存，这里的节点都比它大】
+ * (5)插入时满节点对半分裂、分隔键上移；删除时节点不足半满则向兄弟借一个，借不到就与兄弟合并
+ *
+ * 注意：
+ * (1)插入/删除会在节点间挪动键值对，之前的迭代器全部失效（TreeMap<>的迭代器则不会）
+ * (2)键、值都须可缺省构造（节点里的数组整体构造）
+ * (3)迭代器解引用得到的是{key, value}两个引用组成的临时对象，遍历时用 for (const auto& item : btree)
+ */
+#ifndef __BTREE_MAP__
+#define __BTREE_MAP__
+#include <initializer_list>
+#include <iostream>
+#include <cstdint>      // int64_t
+#include <limits>       // numeric_limits<>
+#include <type_traits>  // is_integral<>, is_signed<>, enable_if<>
+#include <utility>      // move(), swap()
+#include "alloc.hpp"
+#include "utils.hpp"
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>  // SSE2
+#define __BTREE_SSE2__
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>  // AVX2
+#elif defined(__SSE4_2__)
+#include <nmmintrin.h>  // SSE4.2
+#endif
+using namespace std;
+
+
+// """节点内查找"""
+namespace mystl {
+    static const size_t __btree_node_bytes = 512;   // 节点的目标大小（约8条缓存行）
+
+    inline size_t __btree_popcount(unsigned mask) {
+#if defined(__GNUC__) || defined(__clang__)
+        return (size_t)__builtin_popcount(mask);
+#else
+        size_t cnt = 0;
+        for (; mask; mask &= mask-1) ++cnt;
+        return cnt;
+#endif
+    }
+    // 有序的32位有符号整数数组keys[0, n)中比key小的个数
+    inline size_t __btree_count_less32(const int32_t* keys, size_t n, int32_t key) {
+        size_t cnt = 0, i = 0;
+#ifdef __BTREE_SSE2__
+        __m128i k = _mm_set1_epi32(key);
+        for (; i+4 <= n; i += 4) {
+            __m128i less = _mm_cmpgt_epi32(k, _mm_loadu_si128((const __m128i*)(keys+i)));
+            cnt += __btree_popcount((unsigned)_mm_movemask_ps(_mm_castsi128_ps(less)));
+        }
+#endif
+        for (; i < n; ++i) cnt += keys[i] < key;
+        return cnt;
+    }
+    // 有序的64位有符号整数数组keys[0, n)中比key小的个数
+    inline size_t __btree_count_less64(const int64_t* keys, size_t n, int64_t key) {
+        size_t cnt = 0, i = 0;
+#if defined(__AVX2__)
+        __m256i k = _mm256_set1_epi64x(key);
+        for (; i+4 <= n; i += 4) {
+            __m256i less = _mm256_cmpgt_epi64(k, _mm256_loadu_si256((const __m256i*)(keys+i)));
+            cnt += __btree_popcount((unsigned)_mm256_movemask_pd(_mm256_castsi256_pd(less)));
+        }
+#elif defined(__SSE4_2__)
+        __m128i k = _mm_set1_epi64x(key);
+        for (; i+2 <= n; i += 2) {
+            __m128i less = _mm_cmpgt_epi64(k, _mm_loadu_si128((const __m128i*)(keys+i)));
+            cnt += __btree_popcount((unsigned)_mm_movemask_pd(_mm_castsi128_pd(less)));
+        }
+#endif
+        for (; i < n; ++i) cnt += keys[i] < key;
+        return cnt;
+    }
+    // 整数键：无分支地线性计数，32/64位有符号整数走SIMD
+    template <class Key>
+    inline size_t __btree_count_less(const Key* keys, size_t n, Key key) {
+        if (is_signed<Key>::value && sizeof(Key) == 4)
+            return __btree_count_less32((const int32_t*)keys, n, (int32_t)key);
+        if (is_signed<Key>::value && sizeof(Key) == 8)
+            return __btree_count_less64((const int64_t*)keys, n, (int64_t)key);
+        size_t cnt = 0;
+        for (size_t i=0; i<n; ++i) cnt += keys[i] < key;
+        return cnt;
+    }
+
+    // 一般的键：二分查找
+    template <class Key, class KeyCompare, class K, class = void>
+    struct __BTreeSearch {
+        // 比key小的键的个数，即lower_bound的下标
+        static size_t less(const Key* keys, size_t n, const K& key, const KeyCompare& compare) {
+            size_t lo = 0, hi = n;
+            while (lo < hi) {
+                size_t mid = (lo + hi) / 2;
+                if (compare(keys[mid], key) < 0) lo = mid + 1;
+                else hi = mid;
+            }
+            return lo;
+        }
+        // 不大于key的键的个数，即upper_bound的下标
+        static size_t less_equal(const Key* keys, size_t n, const K& key, const KeyCompare& compare) {
+            size_t lo = 0, hi = n;
+            while (lo < hi) {
+                size_t mid = (lo + hi) / 2;
+                if (compare(keys[mid], key) <= 0) lo = mid + 1;
+                else hi = mid;
+            }
+            return lo;
+        }
+    };
+    // 整数键且用缺省的Compare<>：线性计数
+    template <class Key>
+    struct __BTreeSearch<Key, Compare<Key>, Key, typename enable_if<is_integral<Key>::value>::type> {
+        static size_t less(const Key* keys, size_t n, Key key, const Compare<Key>&)
+            { return __btree_count_less(keys, n, key); }
+        static size_t less_equal(const Key* keys, size_t n, Key key, const Compare<Key>&) {
+            if (key == numeric_limits<Key>::max()) return n;    // key已是最大值，不能+1
+            return __btree_count_less(keys, n, (Key)(key + 1));
+        }
+    };
+};
+
+
+// """节点"""
+// 节点的公共部分【is_leaf决定实际类型】
+struct __BTreeNodeBase {
+    unsigned short  count;      // 键数
+    bool            is_leaf;
+};
+
+// 叶节点：存键值对，双向链接
+template <class Key, class Value>
+struct __BTreeLeaf: __BTreeNodeBase {
+    static const size_t __cap_raw = (mystl::__btree_node_bytes - 3*sizeof(void*)) / (sizeof(Key) + sizeof(Value));
+    static const size_t capacity = __cap_raw < 4 ? 4 : (__cap_raw > 255 ? 255 : __cap_raw);
+    __BTreeLeaf<Key, Value>*    prev;
+    __BTreeLeaf<Key, Value>*    next;
+    Key                         keys[capacity];
+    Value                       values[capacity];
+};
+
+// 内部节点：count个分隔键、count+1个孩子
+template <class Key>
+struct __BTreeInner: __BTreeNodeBase {
+    static const size_t __cap_raw = (mystl::__btree_node_bytes - 2*sizeof(void*)) / (sizeof(Key) + sizeof(void*));
+    static const size_t capacity = __cap_raw < 4 ? 4 : (__cap_raw > 255 ? 255 : __cap_raw);
+    Key                 keys[capacity];
+    __BTreeNodeBase*    children[capacity + 1];
+};
+
+
+// """节点池"""
+// 按块向一级分配器要内存，每块__pool_chunk个节点；释放的节点挂回空闲链表，整个池随树一起释放
+template <class Node>
+class __BTreeNodePool {
+    static const size_t __pool_chunk = 64;
+    union __Slot {
+        __Slot* next;
+        alignas(Node) char data[sizeof(Node)];
+    };
+    struct __Chunk {
+        __Chunk* next;
+        __Slot   slots[__pool_chunk];
+    };
+    __Chunk*    _chunks;
+    __Slot*     _free;
+    size_t      _used;          // 最新一块中已切出的节点数
+    __BTreeNodePool(const __BTreeNodePool&);
+    __BTreeNodePool& operator=(const __BTreeNodePool&);
+public:
+    __BTreeNodePool(): _chunks(nullptr), _free(nullptr), _used(__pool_chunk) {}
+    ~__BTreeNodePool() { release(); }
+    // 取一个未构造的节点
+    Node* allocate() {
+        if (_free) {
+            __Slot* slot = _free;
+            _free = slot->next;
+            return (Node*)slot->data;
+        }
+        if (_used == __pool_chunk) {
+            __Chunk* chunk = (__Chunk*)FirstAlloc::allocate(sizeof(__Chunk));
+            chunk->next = _chunks;
+            _chunks = chunk;
+            _used = 0;
+        }
+        return (Node*)_chunks->slots[_used++].data;
+    }
+    // 归还一个已析构的节点
+    void deallocate(Node* node) {
+        __Slot* slot = (__Slot*)node;
+        slot->next = _free;
+        _free = slot;
+    }
+    // 一次归还全部内存【节点须都已析构】
+    void release() {
+        while (_chunks) {
+            __Chunk* next = _chunks->next;
+            FirstAlloc::deallocate(_chunks);
+            _chunks = next;
+        }
+        _free = nullptr;
+        _used = __pool_chunk;
+    }
+    void swap(__BTreeNodePool& other) {
+        std::swap(_chunks, other._chunks);
+        std::swap(_free, other._free);
+        std::swap(_used, other._used);
+    }
+};
+
+
+// """迭代器"""
+// 解引用得到的元素【item.key，item.value】
+template <class Key, class Value>
+struct __BTreeEntry {
+    const Key&  key;
+    Value&      value;
+};
+// 迭代器：(叶节点, 下标)，end()即最后一个叶节点的(leaf, count)
+template <class Key, class Value>
+struct __BTreeIterator {
+    // 类型定义
+    typedef BidirectIteratorTag             iterator_category;  // 双向迭代器
+    typedef __BTreeEntry<Key, Value>        value_type;
+    typedef value_type                      reference;
+    typedef size_t                          size_type;
+    typedef ptrdiff_t                       difference_type;
+    typedef __BTreeIterator<Key, Value>     iterator;
+    typedef __BTreeLeaf<Key, Value>         Leaf;
+    // it->key的代理：保存一个临时的__BTreeEntry
+    struct arrow_proxy {
+        value_type entry;
+        const value_type* operator->() const { return &entry; }
+    };
+    // 成员变量
+    Leaf*       leaf;
+    size_type   idx;
+    // 构造函数
+    __BTreeIterator(): leaf(nullptr), idx(0) {}
+    __BTreeIterator(Leaf* lf, size_type i): leaf(lf), idx(i) {}
+    // *self, ->self, self==other, self!=other
+    value_type operator*() const { value_type entry = { leaf->keys[idx], leaf->values[idx] };  return entry; }
+    arrow_proxy operator->() const { arrow_proxy proxy = { **this };  return proxy; }
+    bool operator==(const iterator& other) const { return leaf == other.leaf && idx == other.idx; }
+    bool operator!=(const iterator& other) const { return !(*this == other); }
+    // ++self, self++, --self, self--【最后一个元素的后继即end()，停在最后一个叶节点末尾】
+    iterator& operator++() {
+        if (++idx == leaf->count && leaf->next) { leaf = leaf->next;  idx = 0; }
+        return *this;
+    }
+    iterator operator++(int) { iterator tmp(*this);  ++*this;  return tmp; }
+    iterator& operator--() {
+        if (idx == 0) { leaf = leaf->prev;  idx = leaf->count; }
+        --idx;
+        return *this;
+    }
+    iterator operator--(int) { iterator tmp(*this);  --*this;  return tmp; }
+};
+
+
+// """B+树映射"""
+template <class Key, class Value, class KeyCompare = Compare<Key> >
+class BTreeMap {
+
+public:     // 【类型定义】
+    typedef Pair<Key, Value>    value_type;
+    typedef size_t              size_type;
+    typedef ptrdiff_t           difference_type;
+    typedef __BTreeLeaf<Key, Value>     Leaf;
+    typedef __BTreeInner<Key>           Inner;
+    typedef __BTreeNodeBase             NodeBase;
+    typedef __BTreeIterator<Key, Value> iterator;
+    static const size_type leaf_capacity = Leaf::capacity;
+    static const size_type inner_capacity = Inner::capacity;
+
+private:    // 【成员变量】
+    KeyCompare                  _compare;
+    NodeBase*                   _root;      // 空树时也有一个空的叶节点作树根
+    Leaf*                       _first;     // 最左、最右的叶节点
+    Leaf*                       _last;
+    size_type                   _size;
+    size_type                   _height;    // 叶节点为第1层
+    __BTreeNodePool<Leaf>       _leaf_pool;
+    __BTreeNodePool<Inner>      _inner_pool;
+    static const size_type __max_height = 64;
+    static const size_type __min_leaf = leaf_capacity / 2;
+    static const size_type __min_inner = (inner_capacity - 1) / 2;
+
+private:    // 【构造/析构节点】
+    Leaf* _make_leaf() {
+        Leaf* leaf = _leaf_pool.allocate();
+        new (leaf) Leaf();
+        leaf->count = 0;
+        leaf->is_leaf = true;
+        leaf->prev = leaf->next = nullptr;
+        return leaf;
+    }
+    Inner* _make_inner() {
+        Inner* inner = _inner_pool.allocate();
+        new (inner) Inner();
+        inner->count = 0;
+        inner->is_leaf = false;
+        return inner;
+    }
+    void _destroy_leaf(Leaf* leaf) {
+        leaf->~Leaf();
+        _leaf_pool.deallocate(leaf);
+    }
+    void _destroy_inner(Inner* inner) {
+        inner->~Inner();
+        _inner_pool.deallocate(inner);
+    }
+    // 析构整棵子树（内存随后由节点池整体归还）
+    void _destroy_tree(NodeBase* node) {
+        if (node->is_leaf) { _destroy_leaf((Leaf*)node);  return; }
+        Inner* inner = (Inner*)node;
+        for (size_type i=0; i<=inner->count; ++i) _destroy_tree(inner->children[i]);
+        _destroy_inner(inner);
+    }
+    void _init() {
+        _first = _last = _make_leaf();
+        _root = _first;
+        _size = 0;
+        _height = 1;
+    }
+
+private:    // 【节点内的增删】
+    template <class K>
+    size_type _less(const Key* keys, size_type n, const K& key) const
+        { return mystl::__BTreeSearch<Key, KeyCompare, K>::less(keys, n, key, _compare); }
+    template <class K>
+    size_type _less_equal(const Key* keys, size_type n, const K& key) const
+        { return mystl::__BTreeSearch<Key, KeyCompare, K>::less_equal(keys, n, key, _compare); }
+    // 把leaf的[from, count)右移一格
+    static void _leaf_shift_right(Leaf* leaf, size_type from) {
+        for (size_type i=leaf->count; i>from; --i) {
+            leaf->keys[i] = std::move(leaf->keys[i-1]);
+            leaf->values[i] = std::move(leaf->values[i-1]);
+        }
+    }
+    // 把leaf的[from+1, count)左移一格（覆盖from）
+    static void _leaf_shift_left(Leaf* leaf, size_type from) {
+        for (size_type i=from; i+1<leaf->count; ++i) {
+            leaf->keys[i] = std::move(leaf->keys[i+1]);
+            leaf->values[i] = std::move(leaf->values[i+1]);
+        }
+    }
+    // 把src的[from, src->count)移到dst末尾
+    static void _leaf_move_tail(Leaf* src, size_type from, Leaf* dst) {
+        for (size_type i=from; i<src->count; ++i, ++dst->count) {
+            dst->keys[dst->count] = std::move(src->keys[i]);
+            dst->values[dst->count] = std::move(src->values[i]);
+        }
+        src->count = (unsigned short)from;
+    }
+    // 在内部节点的第ci个孩子之后插入分隔键sep与孩子child【须未满】
+    static void _inner_insert(Inner* inner, size_type ci, const Key& sep, NodeBase* child) {
+        for (size_type i=inner->count; i>ci; --i) {
+            inner->keys[i] = std::move(inner->keys[i-1]);
+            inner->children[i+1] = inner->children[i];
+        }
+        inner->keys[ci] = sep;
+        inner->children[ci+1] = child;
+        ++inner->count;
+    }
+    // 删除内部节点的第ki个分隔键及其右边的孩子
+    static void _inner_remove(Inner* inner, size_type ki) {
+        for (size_type i=ki; i+1<inner->count; ++i) {
+            inner->keys[i] = std::move(inner->keys[i+1]);
+            inner->children[i+1] = inner->children[i+2];
+        }
+        --inner->count;
+    }
+
+private:    // 【查】
+    // 键为key的元素所在的叶节点与下标，不存在则leaf为nullptr
+    template <class K>
+    Leaf* _find_leaf(const K& key, size_type& idx) const {
+        NodeBase* node = _root;
+        while (!node->is_leaf) {
+            Inner* inner = (Inner*)node;
+            node = inner->children[_less_equal(inner->keys, inner->count, key)];
+        }
+        Leaf* leaf = (Leaf*)node;
+        idx = _less(leaf->keys, leaf->count, key);
+        return idx < leaf->count && _compare(leaf->keys[idx], key) == 0 ? leaf : nullptr;
+    }
+    // 位置(leaf, idx)规整为迭代器：叶节点末尾即下一个叶节点的开头
+    static iterator _normalize(Leaf* leaf, size_type idx) {
+        if (idx == leaf->count && leaf->next) return iterator(leaf->next, 0);
+        return iterator(leaf, idx);
+    }
+    template <class K>
+    iterator _lower_bound(const K& key) const {
+        NodeBase* node = _root;
+        while (!node->is_leaf) {
+            Inner* inner = (Inner*)node;
+            node = inner->children[_less_equal(inner->keys, inner->count, key)];
+        }
+        Leaf* leaf = (Leaf*)node;
+        return _normalize(leaf, _less(leaf->keys, leaf->count, key));
+    }
+    template <class K>
+    iterator _upper_bound(const K& key) const {
+        NodeBase* node = _root;
+        while (!node->is_leaf) {
+            Inner* inner = (Inner*)node;
+            node = inner->children[_less_equal(inner->keys, inner->count, key)];
+        }
+        Leaf* leaf = (Leaf*)node;
+        return _normalize(leaf, _less_equal(leaf->keys, leaf->count, key));
+    }
+
+private:    // 【批量查找】
+    // 节点内查找很快，慢的是每下一层都要等节点读入缓存，而下一层的地址又取决于这一层的查找结果
+    // 改为一组__batch_group个键同步地逐层下降（叶节点都同深，组内各键同时到达叶层）：
+    // 每一层先让组内每个键各下一层并预取其节点，组内的cache miss同时在路上
+    static const size_type __batch_group = 8;
+    static void _prefetch_node(const NodeBase* node) {
+        for (size_type off=0; off<mystl::__btree_node_bytes; off+=64)
+            __prefetch((const char*)node + off);
+    }
+    // 对keys[0, n)逐个调用visit(i, value)，value为键keys[i]的值的指针，不存在则为nullptr
+    template <class KeyArray, class Visitor>
+    void _find_batch(KeyArray keys, size_type n, Visitor visit) const {
+        const size_type G = __batch_group;
+        NodeBase* nodes[G];
+        for (size_type base=0; base<n; base+=G) {
+            size_type g = n-base < G ? n-base : G;
+            for (size_type j=0; j<g; ++j) nodes[j] = _root;
+            while (!nodes[0]->is_leaf) {
+                for (size_type j=0; j<g; ++j) {
+                    Inner* inner = (Inner*)nodes[j];
+                    nodes[j] = inner->children[_less_equal(inner->keys, inner->count, keys[base+j])];
+                    _prefetch_node(nodes[j]);
+                }
+            }
+            for (size_type j=0; j<g; ++j) {
+                Leaf* leaf = (Leaf*)nodes[j];
+                size_type idx = _less(leaf->keys, leaf->count, keys[base+j]);
+                bool hit = idx < leaf->count && _compare(leaf->keys[idx], keys[base+j]) == 0;
+                visit(base+j, hit ? leaf->values+idx : nullptr);
+            }
+        }
+    }
+
+private:    // 【增】
+    // 返回键为key的元素位置，不存在则插入（值初始化）；inserted即是否新插入
+    iterator _insert(const Key& key, bool& inserted) {
+        Inner* path[__max_height];
+        size_type path_idx[__max_height], depth = 0;
+        NodeBase* node = _root;
+        while (!node->is_leaf) {
+            Inner* inner = (Inner*)node;
+            size_type ci = _less_equal(inner->keys, inner->count, key);
+            path[depth] = inner;
+            path_idx[depth++] = ci;
+            node = inner->children[ci];
+        }
+        Leaf* leaf = (Leaf*)node;
+        size_type pos = _less(leaf->keys, leaf->count, key);
+        if (pos < leaf->count && _compare(leaf->keys[pos], key) == 0) { inserted = false;  return iterator(leaf, pos); }
+        inserted = true;
+        ++_size;
+        if (leaf->count < leaf_capacity) {
+            _leaf_shift_right(leaf, pos);
+            leaf->keys[pos] = key;
+            leaf->values[pos] = Value();
+            ++leaf->count;
+            return iterator(leaf, pos);
+        }
+        // 叶节点已满：对半分裂，key放进所属的一半
+        Leaf* right = _make_leaf();
+        size_type mid = leaf_capacity / 2;
+        _leaf_move_tail(leaf, mid, right);
+        right->next = leaf->next;
+        right->prev = leaf;
+        if (leaf->next) leaf->next->prev = right;
+        else _last = right;
+        leaf->next = right;
+        Leaf* target = pos <= mid ? leaf : right;
+        if (pos > mid) pos -= mid;
+        _leaf_shift_right(target, pos);
+        target->keys[pos] = key;
+        target->values[pos] = Value();
+        ++target->count;
+        iterator result(target, pos);
+        // 分隔键逐层上移，满的内部节点继续分裂
+        Key sep = right->keys[0];
+        NodeBase* child = right;
+        while (depth > 0) {
+            Inner* inner = path[--depth];
+            size_type ci = path_idx[depth];
+            if (inner->count < inner_capacity) { _inner_insert(inner, ci, sep, child);  return result; }
+            Inner* sibling = _make_inner();
+            size_type imid = inner->count / 2;
+            Key up = std::move(inner->keys[imid]);
+            for (size_type i=imid+1; i<inner->count; ++i) {
+                sibling->keys[sibling->count] = std::move(inner->keys[i]);
+                sibling->children[sibling->count++] = inner->children[i];
+            }
+            sibling->children[sibling->count] = inner->children[inner->count];
+            inner->count = (unsigned short)imid;
+            if (ci <= imid) _inner_insert(inner, ci, sep, child);
+            else _inner_insert(sibling, ci - imid - 1, sep, child);
+            sep = std::move(up);
+            child = sibling;
+        }
+        // 树根也分裂了：长高一层
+        Inner* root = _make_inner();
+        root->keys[0] = std::move(sep);
+        root->children[0] = _root;
+        root->children[1] = child;
+        root->count = 1;
+        _root = root;
+        ++_height;
+        return result;
+    }
+
+private:    // 【删】
+    // 叶节点leaf（父节点parent的第ci个孩子）不足半满：向兄弟借，借不到就合并
+    void _fix_leaf(Leaf* leaf, Inner* parent, size_type ci) {
+        Leaf* left = ci > 0 ? (Leaf*)parent->children[ci-1] : nullptr;
+        Leaf* right = ci < parent->count ? (Leaf*)parent->children[ci+1] : nullptr;
+        if (left && left->count > __min_leaf) {             // 左兄弟的最后一个挪过来
+            _leaf_shift_right(leaf, 0);
+            leaf->keys[0] = std::move(left->keys[left->count-1]);
+            leaf->values[0] = std::move(left->values[left->count-1]);
+            ++leaf->count;
+            --left->count;
+            parent->keys[ci-1] = leaf->keys[0];
+        }
+        else if (right && right->count > __min_leaf) {      // 右兄弟的第一个挪过来
+            leaf->keys[leaf->count] = std::move(right->keys[0]);
+            leaf->values[leaf->count] = std::move(right->values[0]);
+            ++leaf->count;
+            _leaf_shift_left(right, 0);
+            --right->count;
+            parent->keys[ci] = right->keys[0];
+        }
+        else {                                              // 合并：右边的并入左边，删掉右边
+            if (!left) { left = leaf;  leaf = right;  ++ci; }
+            _leaf_move_tail(leaf, 0, left);
+            left->next = leaf->next;
+            if (leaf->next) leaf->next->prev = left;
+            else _last = left;
+            _destroy_leaf(leaf);
+            _inner_remove(parent, ci-1);
+        }
+    }
+    // 内部节点node（父节点parent的第ci个孩子）不足半满：同上，分隔键经由父节点旋转
+    void _fix_inner(Inner* node, Inner* parent, size_type ci) {
+        Inner* left = ci > 0 ? (Inner*)parent->children[ci-1] : nullptr;
+        Inner* right = ci < parent->count ? (Inner*)parent->children[ci+1] : nullptr;
+        if (left && left->count > __min_inner) {
+            node->children[node->count+1] = node->children[node->count];
+            for (size_type i=node->count; i>0; --i) {
+                node->keys[i] = std::move(node->keys[i-1]);
+                node->children[i] = node->children[i-1];
+            }
+            node->keys[0] = std::move(parent->keys[ci-1]);
+            node->children[0] = left->children[left->count];
+            ++node->count;
+            parent->keys[ci-1] = std::move(left->keys[left->count-1]);
+            --left->count;
+        }
+        else if (right && right->count > __min_inner) {
+            node->keys[node->count] = std::move(parent->keys[ci]);
+            node->children[node->count+1] = right->children[0];
+            ++node->count;
+            parent->keys[ci] = std::move(right->keys[0]);
+            for (size_type i=0; i+1<right->count; ++i) {
+                right->keys[i] = std::move(right->keys[i+1]);
+                right->children[i] = right->children[i+1];
+            }
+            right->children[right->count-1] = right->children[right->count];
+            --right->count;
+        }
+        else {
+            if (!left) { left = node;  node = right;  ++ci; }
+            left->keys[left->count] = std::move(parent->keys[ci-1]);
+            ++left->count;
+            for (size_type i=0; i<node->count; ++i) {
+                left->keys[left->count] = std::move(node->keys[i]);
+                left->children[left->count++] = node->children[i];
+            }
+            left->children[left->count] = node->children[node->count];
+            _destroy_inner(node);
+            _inner_remove(parent, ci-1);
+        }
+    }
+    template <class K>
+    size_type _erase(const K& key) {
+        Inner* path[__max_height];
+        size_type path_idx[__max_height], depth = 0;
+        NodeBase* node = _root;
+        while (!node->is_leaf) {
+            Inner* inner = (Inner*)node;
+            size_type ci = _less_equal(inner->keys, inner->count, key);
+            path[depth] = inner;
+            path_idx[depth++] = ci;
+            node = inner->children[ci];
+        }
+        Leaf* leaf = (Leaf*)node;
+        size_type pos = _less(leaf->keys, leaf->count, key);
+        if (pos == leaf->count || _compare(leaf->keys[pos], key) != 0) return 0;
+        _leaf_shift_left(leaf, pos);
+        --leaf->count;
+        leaf->keys[leaf->count] = Key();        // 释放被挪空的槽位持有的资源（如string的堆内存）
+        leaf->values[leaf->count] = Value();
+        --_size;
+        // 分隔键不必更新：删掉一个键后，它们仍然正确地分隔左右子树
+        if (depth == 0 || leaf->count >= __min_leaf) return 1;
+        _fix_leaf(leaf, path[depth-1], path_idx[depth-1]);
+        for (--depth; depth > 0 && path[depth]->count < __min_inner; --depth)
+            _fix_inner(path[depth], path[depth-1], path_idx[depth-1]);
+        if (!_root->is_leaf && ((Inner*)_root)->count == 0) {    // 树根只剩一个孩子：矮一层
+            Inner* old_root = (Inner*)_root;
+            _root = old_root->children[0];
+            _destroy_inner(old_root);
+            --_height;
+        }
+        return 1;
+    }
+
+public:     // 【构造/析构函数】
+    BTreeMap() { _init(); }
+    BTreeMap(initializer_list<value_type> init_list) {
+        _init();
+        for (const auto& item : init_list) insert(item.first, item.second);
+    }
+    BTreeMap(const BTreeMap& other): _compare(other._compare) {
+        _init();
+        for (const auto& item : other) insert(item.key, item.value);
+    }
+    BTreeMap& operator=(const BTreeMap& other) {
+        if (this != &other) {
+            BTreeMap copy(other);
+            swap(copy);
+        }
+        return *this;
+    }
+    ~BTreeMap() { _destroy_tree(_root); }
+    void swap(BTreeMap& other) {
+        std::swap(_compare, other._compare);    std::swap(_root, other._root);
+        std::swap(_first, other._first);        std::swap(_last, other._last);
+        std::swap(_size, other._size);          std::swap(_height, other._height);
+        _leaf_pool.swap(other._leaf_pool);
+        _inner_pool.swap(other._inner_pool);
+    }
+
+public:     // 【Basic Accessor】
+    size_type size()    const { return _size; }
+    bool empty()        const { return _size == 0; }
+    size_type height()  const { return _height; }
+    iterator begin()    const { return iterator(_first, 0); }
+    iterator end()      const { return iterator(_last, _last->count); }
+    // 最小/最大的元素【须非空】
+    __BTreeEntry<Key, Value> front() const { return *begin(); }
+    __BTreeEntry<Key, Value> back()  const { return *--end(); }
+
+public:     // 【增、改、查】
+    // 插入键值对，键已存在则覆盖其值
+    void insert(const Key& key, const Value& value) {
+        bool inserted;
+        iterator it = _insert(key, inserted);
+        it.leaf->values[it.idx] = value;
+    }
+    // 键不存在时插入Value()
+    Value& operator[](const Key& key) {
+        bool inserted;
+        iterator it = _insert(key, inserted);
+        return it.leaf->values[it.idx];
+    }
+    const Value& operator[](const Key& key) const {
+        size_type idx;
+        Leaf* leaf = _find_leaf(key, idx);
+        if (!leaf) {
+            cerr << "warning: " << "key not found in BTreeMap(at " << this << ")!" << endl;
+            static const Value default_value = Value();
+            return default_value;
+        }
+        return leaf->values[idx];
+    }
+    iterator find(const Key& key) const {
+        size_type idx;
+        Leaf* leaf = _find_leaf(key, idx);
+        return leaf ? iterator(leaf, idx) : end();
+    }
+    bool contains(const Key& key)    const { size_type idx;  return _find_leaf(key, idx) != nullptr; }
+    size_type count(const Key& key)  const { return contains(key) ? 1 : 0; }
+    // 第一个键>=key / >key的位置，[lower_bound(lo), upper_bound(hi))即键在[lo, hi]内的全部元素
+    iterator lower_bound(const Key& key) const { return _lower_bound(key); }
+    iterator upper_bound(const Key& key) const { return _upper_bound(key); }
+    Pair<iterator, iterator> equal_range(const Key& key) const
+        { return Pair<iterator, iterator>(lower_bound(key), upper_bound(key)); }
+    // 透明查找：KeyCompare声明了is_transparent时，可直接以const char*/StringView等查找，不构造临时Key
+    template <class K, class = typename __TransparentKey<KeyCompare, KeyCompare, K>::type>
+    iterator find(const K& key) const {
+        size_type idx;
+        Leaf* leaf = _find_leaf(key, idx);
+        return leaf ? iterator(leaf, idx) : end();
+    }
+    template <class K, class = typename __TransparentKey<KeyCompare, KeyCompare, K>::type>
+    bool contains(const K& key)      const { size_type idx;  return _find_leaf(key, idx) != nullptr; }
+    template <class K, class = typename __TransparentKey<KeyCompare, KeyCompare, K>::type>
+    size_type count(const K& key)    const { return contains(key) ? 1 : 0; }
+    template <class K, class = typename __TransparentKey<KeyCompare, KeyCompare, K>::type>
+    iterator lower_bound(const K& key) const { return _lower_bound(key); }
+    template <class K, class = typename __TransparentKey<KeyCompare, KeyCompare, K>::type>
+    iterator upper_bound(const K& key) const { return _upper_bound(key); }
+
+public:     // 【批量查找】一组键同步逐层下降、预取下一层节点，让多个cache miss重叠【一批上千个键、树远大于缓存时效果最好】
+    // out[i]即键keys[i]对应值的指针，不存在则为nullptr；返回找到的个数
+    size_type find_batch(const Key* keys, size_type n, Value** out) const {
+        size_type found = 0;
+        _find_batch(keys, n, [&](size_type i, Value* value) {
+            out[i] = value;
+            found += value != nullptr;
+        });
+        return found;
+    }
+    template <class K, class = typename __TransparentKey<KeyCompare, KeyCompare, K>::type>
+    size_type find_batch(const K* keys, size_type n, Value** out) const {
+        size_type found = 0;
+        _find_batch(keys, n, [&](size_type i, Value* value) {
+            out[i] = value;
+            found += value != nullptr;
+        });
+        return found;
+    }
+
+public:     // 【删】
+    size_type erase(const Key& key) { return _erase(key); }
+    // 删除position处的元素，返回其后一个元素的位置【其余迭代器都失效】
+    iterator erase(iterator position) {
+        Key key = position.leaf->keys[position.idx];
+        _erase(key);
+        return _lower_bound(key);
+    }
+    void clear() {
+        _destroy_tree(_root);
+        _leaf_pool.release();
+        _inner_pool.release();
+        _init();
+    }
+};
+
+// cout << btree_map;
+template <class Key, class Value, class KeyCompare>
+ostream& operator<<(ostream& out, const BTreeMap<Key, Value, KeyCompare>& btree_map) {
+    out << "{ ";
+    for (const auto& item : btree_map) out << item.key << ": " << item.value << ", ";
+    return out << "}";
+}
+
+
+#endif // __BTREE_MAP__
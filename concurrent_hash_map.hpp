@@ -0,0 +1,392 @@
+/* concurrent_hash_map.hpp
+ * 【并发哈希映射】多线程同时读写，读操作不加锁
+ * 与hash_map.hpp一样是“桶数组 + 链表”，参考Java的ConcurrentHashMap
+ *
+ * 设计：
+ * (1)写：按哈希值分成__n_stripes个锁分段(stripe)，写者只锁键所在的分段，不同分段的写互不阻塞
+ *    桶数组长度总是2的幂且不小于分段数，桶号 = hash & (长度-1)，分段号 = hash & (分段数-1)，
+ *    同一个键无论扩容多少次都属于同一个分段
+ * (2)读：不加锁，只进入epoch临界区（见epoch.hpp），沿着atomic的next指针遍历链表
+ * (3)节点一经发布就不再修改键和值（copy-on-write）：改值即新建节点替换旧节点，
+ *    读者要么读到旧值要么读到新值，不会读到写了一半的值；摘下的旧节点交给epoch_retire()延迟释放
+ * (4)扩容：逐个分段地迁移到两倍长的新桶数组，每次只锁一个分段，别的分段照常写【参考Java的transfer()】
+ *    旧桶b只会拆到新桶b、b+旧长度，二者与b同属一个分段；迁移完的旧桶换成转发标记，读者遇到它就转去新桶数组查找
+ *    写者锁住自己的分段时若发现它还没迁移，就顺手先把它迁移了，不必等扩容的线程轮到它
+ *    读者可能还在旧链表上，不能改链：链表末尾去向相同的一段（lastRun）原样复用，其余节点复制，
+ *    被复制的旧节点在每个分段迁移完后即退休；全部迁移完再发布新桶数组，旧桶数组退休
+ * (5)计数：每个分段各自计数（在分段锁内修改），size()求和，写者之间没有共享的计数器
+ *
+ * 注意：
+ * (1)没有迭代器；find()把值拷贝出来，for_each()在临界区内遍历，只保证弱一致性
+ * (2)节点与桶数组必须用线程安全的内存分配器，故只用一级内存分配器（malloc/free）
+ */
+#ifndef __CONCURRENT_HASH_MAP__
+#define __CONCURRENT_HASH_MAP__
+#include <initializer_list>
+#include <iostream>
+#include <atomic>       // atomic<>
+#include <mutex>        // mutex, lock_guard<>
+#include <new>          // placement new
+#include "alloc.hpp"
+#include "utils.hpp"
+#include "epoch.hpp"
+using namespace std;
+
+
+// 节点【键、值发布后不再修改，只有next会变】
+template <class Key, class Value>
+struct __ConcurrentHashMapNode {
+    size_t                                      hash;
+    Key                                         key;
+    Value                                       value;
+    atomic<__ConcurrentHashMapNode<Key, Value>*> next;
+    __ConcurrentHashMapNode(size_t h, const Key& k, const Value& v, __ConcurrentHashMapNode* n):
+        hash(h), key(k), value(v), next(n) {}
+};
+
+// 锁分段【独占一个缓存行，避免不同分段的锁互相伪共享】
+struct alignas(64) __ConcurrentStripe {
+    mutex           lock;
+    atomic<size_t>  count;      // 本分段的节点数，只在持有lock时修改
+    __ConcurrentStripe(): count(0) {}
+};
+
+
+// """并发哈希映射[Java ConcurrentHashMap]"""
+template <class Key,
+          class Value,
+          class KeyHasher   = HashCode<Key>,
+          class KeyCompare  = Compare<Key> >
+class ConcurrentHashMap {
+
+public:     // 【类型定义】
+    typedef Pair<Key, Value>    value_type;
+    typedef size_t              size_type;
+    typedef __ConcurrentHashMapNode<Key, Value> Node;
+    typedef atomic<Node*>                       Bucket;
+    typedef Allocator<Node>                     node_allocator;     // 一级内存分配器，线程安全
+    typedef Allocator<Bucket>                   bucket_allocator;
+    static const size_type __n_stripes = 64;                        // 锁分段数（2的幂）
+    static const size_type __min_table_size = 16 * __n_stripes;     // 桶数组最小长度
+
+private:    // 【桶数组】
+    struct Table {
+        size_type       size;       // 2的幂
+        Bucket*         buckets;
+        atomic<Table*>  next;       // 正在迁移到的新桶数组，没在扩容则为nullptr
+    };
+
+private:    // 【成员变量】
+    KeyCompare          _compare;
+    KeyHasher           _hasher;
+    atomic<Table*>      _table;
+    mutex               _resize_lock;   // 同一时刻只有一个线程扩容（或clear()）
+    __ConcurrentStripe  _stripes[__n_stripes];
+
+private:    // 【哈希】
+    // 同FlatHashMap<>：再混合一次，低位（桶号、分段号）才足够均匀
+    static size_type _mix(size_type hash_code) {
+        uint64_t h = (uint64_t)hash_code;
+        h ^= h >> 33;  h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;  h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return (size_type)h;
+    }
+    template <class K>
+    size_type _hash(const K& key) const { return _mix(_hasher(key)); }
+    __ConcurrentStripe& _stripe_of(size_type hash) { return _stripes[hash & (__n_stripes-1)]; }
+
+private:    // 【节点、桶数组的构造/释放】
+    static Node* _make_node(size_type hash, const Key& key, const Value& value, Node* next)
+        { return new (node_allocator::allocate(1)) Node(hash, key, value, next); }
+    static void _destroy_node(Node* node) {
+        node->~Node();
+        node_allocator::deallocate(node);
+    }
+    static void _retire_node(void* node) { _destroy_node((Node*)node); }
+    static Table* _make_table(size_type size) {
+        Table* table = Allocator<Table>::allocate(1);
+        table->size = size;
+        table->buckets = bucket_allocator::allocate(size);
+        for (size_type i=0; i<size; ++i) new (table->buckets+i) Bucket(nullptr);
+        new (&table->next) atomic<Table*>(nullptr);
+        return table;
+    }
+    // 只释放桶数组本身（节点已迁移走）
+    static void _retire_buckets(void* table) {
+        bucket_allocator::deallocate(((Table*)table)->buckets);
+        Allocator<Table>::deallocate((Table*)table);
+    }
+    // 释放桶数组及其上的全部节点
+    static void _destroy_table(Table* table) {
+        for (size_type i=0; i<table->size; ++i) {
+            Node *cur = table->buckets[i].load(memory_order_relaxed), *next;
+            for (; cur; cur=next) {
+                next = cur->next.load(memory_order_relaxed);
+                _destroy_node(cur);
+            }
+        }
+        bucket_allocator::deallocate(table->buckets);
+        Allocator<Table>::deallocate(table);
+    }
+    static void _retire_table(void* table) { _destroy_table((Table*)table); }
+
+private:    // 【扩容】
+    void _lock_all()   { for (size_type i=0; i<__n_stripes; ++i) _stripes[i].lock.lock(); }
+    void _unlock_all() { for (size_type i=__n_stripes; i>0; --i) _stripes[i-1].lock.unlock(); }
+    // 转发标记：旧桶已迁移到table->next，不是合法的节点地址
+    static Node* _moved() { return reinterpret_cast<Node*>(uintptr_t(1)); }
+    // 把旧桶数组中分段s的全部桶迁移到new_table，调用者须持有分段s的锁
+    static void _transfer(Table* old_table, Table* new_table, size_type s) {
+        size_type old_size = old_table->size;
+        for (size_type i=s; i<old_size; i+=__n_stripes) {
+            Node* head = old_table->buckets[i].load(memory_order_relaxed);
+            // lastRun：从它开始到链尾都去往同一个新桶，整段复用；它之前的节点复制到各自的新桶
+            Node* last_run = head;
+            size_type last_bit = head ? head->hash & old_size : 0;
+            for (Node* cur = head; cur; cur = cur->next.load(memory_order_relaxed))
+                if ((cur->hash & old_size) != last_bit) { last_bit = cur->hash & old_size;  last_run = cur; }
+            Node* lo = last_bit ? nullptr : last_run;
+            Node* hi = last_bit ? last_run : nullptr;
+            for (Node* cur = head; cur != last_run; cur = cur->next.load(memory_order_relaxed)) {
+                Node*& list = (cur->hash & old_size) ? hi : lo;
+                list = _make_node(cur->hash, cur->key, cur->value, list);
+            }
+            new_table->buckets[i].store(lo, memory_order_release);
+            new_table->buckets[i+old_size].store(hi, memory_order_release);
+            old_table->buckets[i].store(_moved(), memory_order_release);
+            // 旧链表已不可达（读者只会通过转发标记去新桶），被复制的节点可以退休了
+            for (Node *cur = head, *next; cur != last_run; cur = next) {
+                next = cur->next.load(memory_order_relaxed);
+                mystl::epoch_retire(cur, _retire_node);
+            }
+        }
+    }
+    // 持有分段s的锁时，返回分段s的键所在的桶数组：正在扩容且分段s还没迁移，就先迁移它
+    // 返回的桶数组在释放分段锁之前不会退休（再次扩容要先迁移分段s，也就要先拿到这把锁）
+    Table* _locked_table(size_type s) {
+        EpochGuard guard;                       // 分段s已迁移时，旧桶数组随时可能退休，读它要在临界区内
+        Table* table = _table.load(memory_order_acquire);
+        for (Table* next; (next = table->next.load(memory_order_acquire)); table = next)
+            if (table->buckets[s].load(memory_order_relaxed) != _moved())
+                _transfer(table, next, s);
+        return table;
+    }
+    // 桶数组长度翻倍：逐个分段迁移，每次只锁一个分段
+    void _grow(Table* seen) {
+        if (!_resize_lock.try_lock()) return;   // 已有线程在扩容，写者不必等它
+        Table* old_table = _table.load(memory_order_relaxed);
+        if (old_table == seen) {                // 别的写者可能已经扩过了
+            Table* new_table = _make_table(old_table->size * 2);
+            old_table->next.store(new_table, memory_order_release);
+            for (size_type s=0; s<__n_stripes; ++s) {
+                lock_guard<mutex> lock(_stripes[s].lock);
+                if (old_table->buckets[s].load(memory_order_relaxed) != _moved())
+                    _transfer(old_table, new_table, s);
+            }
+            _table.store(new_table, memory_order_release);
+            mystl::epoch_retire(old_table, _retire_buckets);
+        }
+        _resize_lock.unlock();
+    }
+    // 分段内的节点数超过它应分摊的桶数（负载因子 > 1）即扩容
+    bool _need_grow(const __ConcurrentStripe& stripe, const Table* table) const
+        { return stripe.count.load(memory_order_relaxed) > table->size / __n_stripes; }
+
+private:    // 【查】
+    // 在桶数组table中查找，遇到转发标记则转去新桶数组；调用者须在epoch临界区内或持有key所在分段的锁
+    template <class K>
+    Node* _find_in(const Table* table, size_type hash, const K& key) const {
+        Node* cur = table->buckets[hash & (table->size-1)].load(memory_order_acquire);
+        while (cur == _moved()) {
+            table = table->next.load(memory_order_acquire);
+            cur = table->buckets[hash & (table->size-1)].load(memory_order_acquire);
+        }
+        for (; cur; cur = cur->next.load(memory_order_acquire))
+            if (cur->hash == hash && _compare(cur->key, key) == 0) return cur;
+        return nullptr;
+    }
+    // 遍历table的第i个桶，已迁移则遍历它拆成的两个新桶
+    template <class Function>
+    static void _for_each_in(const Table* table, size_type i, Function& func) {
+        const Node* cur = table->buckets[i].load(memory_order_acquire);
+        if (cur == _moved()) {
+            const Table* next = table->next.load(memory_order_acquire);
+            _for_each_in(next, i, func);
+            _for_each_in(next, i + table->size, func);
+            return;
+        }
+        for (; cur; cur = cur->next.load(memory_order_acquire))
+            func(cur->key, cur->value);
+    }
+
+public:     // 【构造/析构函数】
+    ConcurrentHashMap(): _table(_make_table(__min_table_size)) {}
+    ConcurrentHashMap(initializer_list<value_type> init_list): _table(_make_table(__min_table_size)) {
+        for (const auto& item : init_list)
+            insert_or_assign(item.first, item.second);
+    }
+    // 析构时不能再有其他线程访问；已退休的节点与桶数组由epoch机制释放
+    ~ConcurrentHashMap() { _destroy_table(_table.load(memory_order_relaxed)); }
+private:
+    ConcurrentHashMap(const ConcurrentHashMap&);
+    ConcurrentHashMap& operator=(const ConcurrentHashMap&);
+
+public:     // 【Basic Accessor】
+    // 各分段计数之和，有并发写时只是近似值
+    size_type size() const {
+        size_type n = 0;
+        for (size_type i=0; i<__n_stripes; ++i) n += _stripes[i].count.load(memory_order_relaxed);
+        return n;
+    }
+    bool empty()            const { return size() == 0; }
+    size_type bucket_count()const { return _table.load(memory_order_acquire)->size; }
+
+public:     // 【查】不加锁
+    // 找到则把值拷贝到value并返回true
+    bool find(const Key& key, Value& value) const {
+        EpochGuard guard;
+        const Node* node = _find_in(_table.load(memory_order_acquire), _hash(key), key);
+        if (node) value = node->value;
+        return node != nullptr;
+    }
+    bool contains(const Key& key) const {
+        EpochGuard guard;
+        return _find_in(_table.load(memory_order_acquire), _hash(key), key) != nullptr;
+    }
+    size_type count(const Key& key) const { return contains(key) ? 1 : 0; }
+    // 透明查找：KeyHasher与KeyCompare都声明了is_transparent时，可直接以const char*/StringView等查找
+    template <class K, class = typename __TransparentKey<KeyHasher, KeyCompare, K>::type>
+    bool find(const K& key, Value& value) const {
+        EpochGuard guard;
+        const Node* node = _find_in(_table.load(memory_order_acquire), _hash(key), key);
+        if (node) value = node->value;
+        return node != nullptr;
+    }
+    template <class K, class = typename __TransparentKey<KeyHasher, KeyCompare, K>::type>
+    bool contains(const K& key) const {
+        EpochGuard guard;
+        return _find_in(_table.load(memory_order_acquire), _hash(key), key) != nullptr;
+    }
+    // 在临界区内遍历全部键值对，func(key, value)；与并发写同时进行时只保证弱一致性
+    template <class Function>
+    void for_each(Function func) const {
+        EpochGuard guard;
+        const Table* table = _table.load(memory_order_acquire);
+        for (size_type i=0; i<table->size; ++i)
+            _for_each_in(table, i, func);
+    }
+
+public:     // 【增、改】只锁键所在的分段
+    // 键不存在时插入，返回是否插入
+    bool insert(const Key& key, const Value& value) {
+        size_type hash = _hash(key);
+        __ConcurrentStripe& stripe = _stripe_of(hash);
+        Table* table;
+        {
+            lock_guard<mutex> lock(stripe.lock);
+            table = _locked_table(hash & (__n_stripes-1));  // 持有分段锁时分段所在的桶数组不会变
+            if (_find_in(table, hash, key)) return false;
+            Bucket& bucket = table->buckets[hash & (table->size-1)];
+            bucket.store(_make_node(hash, key, value, bucket.load(memory_order_relaxed)), memory_order_release);
+            stripe.count.store(stripe.count.load(memory_order_relaxed) + 1, memory_order_relaxed);
+            if (!_need_grow(stripe, table)) return true;
+        }
+        _grow(table);
+        return true;
+    }
+    // 原子地插入或覆盖，返回true即插入、false即覆盖
+    bool insert_or_assign(const Key& key, const Value& value) {
+        size_type hash = _hash(key);
+        __ConcurrentStripe& stripe = _stripe_of(hash);
+        Table* table;
+        {
+            lock_guard<mutex> lock(stripe.lock);
+            table = _locked_table(hash & (__n_stripes-1));
+            Bucket* link = &table->buckets[hash & (table->size-1)];
+            for (Node* cur = link->load(memory_order_relaxed); cur; cur = cur->next.load(memory_order_relaxed)) {
+                if (cur->hash == hash && _compare(cur->key, key) == 0) {
+                    // copy-on-write：新节点接上cur的后继，再替换掉cur
+                    link->store(_make_node(hash, key, value, cur->next.load(memory_order_relaxed)), memory_order_release);
+                    mystl::epoch_retire(cur, _retire_node);
+                    return false;
+                }
+                link = &cur->next;
+            }
+            Bucket& bucket = table->buckets[hash & (table->size-1)];
+            bucket.store(_make_node(hash, key, value, bucket.load(memory_order_relaxed)), memory_order_release);
+            stripe.count.store(stripe.count.load(memory_order_relaxed) + 1, memory_order_relaxed);
+            if (!_need_grow(stripe, table)) return true;
+        }
+        _grow(table);
+        return true;
+    }
+    // 键存在则返回其值；否则在分段锁内调用一次make()求值并插入，返回新值
+    // 同一个键并发调用时make()只会被执行一次
+    template <class Function>
+    Value compute_if_absent(const Key& key, Function make) {
+        size_type hash = _hash(key);
+        {
+            EpochGuard guard;               // 先无锁地查一次，键已存在时不必抢锁
+            const Node* node = _find_in(_table.load(memory_order_acquire), hash, key);
+            if (node) return node->value;
+        }
+        __ConcurrentStripe& stripe = _stripe_of(hash);
+        Table* table;
+        Value value;
+        {
+            lock_guard<mutex> lock(stripe.lock);
+            table = _locked_table(hash & (__n_stripes-1));
+            const Node* node = _find_in(table, hash, key);
+            if (node) return node->value;
+            value = make();
+            Bucket& bucket = table->buckets[hash & (table->size-1)];
+            bucket.store(_make_node(hash, key, value, bucket.load(memory_order_relaxed)), memory_order_release);
+            stripe.count.store(stripe.count.load(memory_order_relaxed) + 1, memory_order_relaxed);
+            if (!_need_grow(stripe, table)) return value;
+        }
+        _grow(table);
+        return value;
+    }
+
+public:     // 【删】
+    // 返回删除的节点数（0或1）
+    size_type erase(const Key& key) {
+        size_type hash = _hash(key);
+        __ConcurrentStripe& stripe = _stripe_of(hash);
+        lock_guard<mutex> lock(stripe.lock);
+        Table* table = _locked_table(hash & (__n_stripes-1));
+        Bucket* link = &table->buckets[hash & (table->size-1)];
+        for (Node* cur = link->load(memory_order_relaxed); cur; cur = cur->next.load(memory_order_relaxed)) {
+            if (cur->hash == hash && _compare(cur->key, key) == 0) {
+                link->store(cur->next.load(memory_order_relaxed), memory_order_release);   // 读者停在cur上仍可继续往后走
+                mystl::epoch_retire(cur, _retire_node);
+                stripe.count.store(stripe.count.load(memory_order_relaxed) - 1, memory_order_relaxed);
+                return 1;
+            }
+            link = &cur->next;
+        }
+        return 0;
+    }
+    // 换上一个空的桶数组，旧的整体退休
+    void clear() {
+        lock_guard<mutex> resize_lock(_resize_lock);    // 等正在进行的扩容迁移完
+        _lock_all();
+        Table* old_table = _table.load(memory_order_relaxed);
+        _table.store(_make_table(__min_table_size), memory_order_release);
+        for (size_type i=0; i<__n_stripes; ++i) _stripes[i].count.store(0, memory_order_relaxed);
+        _unlock_all();
+        mystl::epoch_retire(old_table, _retire_table);
+    }
+};
+
+// cout << concurrent_hash_map;
+template <class Key, class Value, class KeyHasher, class KeyCompare>
+ostream& operator<<(ostream& out, const ConcurrentHashMap<Key, Value, KeyHasher, KeyCompare>& hash_map) {
+    out << "{ ";
+    hash_map.for_each([&out](const Key& key, const Value& value) { out << key << ": " << value << ", "; });
+    return out << "}";
+}
+
+
+#endif // __CONCURRENT_HASH_MAP__
@@ -0,0 +1,500 @@
+/* concurrent_skip_list_map.hpp
+ * 【并发跳表映射】多线程同时读写的有序映射，读不加锁、写也不加锁（CAS）
+ * 参考Java的ConcurrentSkipListMap以及Herlihy & Shavit《The Art of Multiprocessor Programming》的LockFreeSkipList
+ * 红黑树的旋转一次要改好几个节点，无法不加锁地并发修改；跳表的每一层都是一条有序链表，插入/删除只需逐层CAS一个指针
+ *
+ * 设计：
+ * (1)节点是一座“塔”：高度h按几率1/4逐层递减地随机取，next[0..h)是它在各层链表上的后继，第0层链表含全部节点
+ * (2)插入：先在第0层CAS接入（此刻即已插入），再自底向上逐层接入；某层CAS失败就重新查找前驱后再试
+ * (3)删除（Harris的标记指针）：先自顶向下把节点各层next指针的最低位置1（逻辑删除），第0层置位成功者即删除者；
+ *    之后任何查找路过带标记的节点时都顺手把它从该层摘下（物理删除）
+ * (4)内存回收：摘下的节点交给epoch_retire()（见epoch.hpp），等所有可能停在它上面的读者离开后才释放；
+ *    塔可能还在被插入者逐层接入时就被删除，故节点的state记下“插入完毕”“已删除”两件事，后完成的一方负责摘下并退休
+ * (5)节点内存来自按塔高分类的线程缓存池：每个线程各有一组空闲链表，分配/释放都不加锁、不共享缓存行，
+ *    空了/满了才与全局仓库整批（__tcache_batch个）交换，只有这一步加锁
+ * (6)计数：按线程分到__n_counters个各占一条缓存行的计数器上，size()求和，写者之间没有共享的计数器
+ *
+ * 注意：
+ * (1)没有迭代器；find()把值拷贝出来，for_each()/for_each_range()在临界区内遍历，只保证弱一致性
+ * (2)节点发布后键、值都不再修改，键已存在时insert()返回false而不覆盖
+ * (3)线程缓存池的内存只在池内循环使用，不归还给系统（同二级内存分配器）
+ */
+#ifndef __CONCURRENT_SKIP_LIST_MAP__
+#define __CONCURRENT_SKIP_LIST_MAP__
+#include <initializer_list>
+#include <iostream>
+#include <atomic>       // atomic<>
+#include <cstdint>      // uintptr_t, uint64_t
+#include <mutex>        // mutex, lock_guard<>
+#include <new>          // placement new
+#include "alloc.hpp"
+#include "utils.hpp"
+#include "epoch.hpp"
+using namespace std;
+
+
+namespace mystl {
+    static const int    __skip_list_max_height = 16;    // 几率1/4时足够40亿个节点
+    static const size_t __tcache_batch = 32;            // 线程缓存与全局仓库每次交换的块数
+    static const size_t __n_counters = 16;              // 计数器分片数
+
+    // 本线程的随机塔高：几率1/4逐层递减（xorshift64*，每个线程各自的状态，不必同步）
+    inline int __skip_list_random_height() {
+        static atomic<uint64_t> seed_counter(0);
+        static thread_local uint64_t state = 0;
+        if (state == 0) state = (seed_counter.fetch_add(1, memory_order_relaxed) + 1) * 0x9E3779B97F4A7C15ULL;
+        state ^= state >> 12;  state ^= state << 25;  state ^= state >> 27;
+        uint64_t r = state * 0x2545F4914F6CDD1DULL;
+        int height = 1;
+        while ((r & 3) == 0 && height < __skip_list_max_height) { ++height;  r >>= 2; }
+        return height;
+    }
+    // 本线程使用的计数器分片号
+    inline size_t __skip_list_counter_slot() {
+        static atomic<size_t> next_slot(0);
+        static thread_local size_t slot = next_slot.fetch_add(1, memory_order_relaxed) % __n_counters;
+        return slot;
+    }
+};
+
+
+// """线程缓存池"""
+// 空闲块串成单链表，块的头一个字即next
+struct __TCacheList {
+    void*   head;
+    size_t  count;
+};
+
+// 按尺寸类分配定长块：SizeClass::block_size(c)为第c类的块大小；各线程有自己的空闲链表，
+// 链表空了从全局仓库取一批（仓库也空则向一级分配器要一块新内存切开），超过两批则还一批给仓库
+template <class SizeClass, size_t NClasses>
+class __ThreadCachePool {
+private:    // 【全局仓库】只有这里加锁
+    struct Depot {
+        mutex           lock;
+        __TCacheList    lists[NClasses];
+        Depot() { for (size_t c=0; c<NClasses; ++c) { lists[c].head = nullptr;  lists[c].count = 0; } }
+    };
+    static Depot& _depot() {
+        static Depot depot;
+        return depot;
+    }
+    // 线程缓存【平凡析构，线程退出时的其他thread_local析构函数（如epoch的垃圾回收）里仍可访问】
+    struct Cache {
+        __TCacheList    lists[NClasses];
+        bool            dead;       // 本线程的缓存已交还仓库，此后直接与仓库交互
+    };
+    static Cache& _cache() {
+        static thread_local Cache cache;    // 零初始化
+        return cache;
+    }
+    // 线程退出时把缓存整体交还仓库
+    struct Flusher {
+        ~Flusher() {
+            Cache& cache = _cache();
+            for (size_t c=0; c<NClasses; ++c)
+                while (cache.lists[c].count > 0) _give_back(cache.lists[c], c, cache.lists[c].count);
+            cache.dead = true;
+        }
+    };
+    static void _touch_flusher() {
+        static thread_local Flusher flusher;
+        (void)flusher;
+    }
+
+private:    // 【线程缓存与仓库之间的整批交换】
+    static void _push(__TCacheList& list, void* block) {
+        *(void**)block = list.head;
+        list.head = block;
+        ++list.count;
+    }
+    static void* _pop(__TCacheList& list) {
+        void* block = list.head;
+        list.head = *(void**)block;
+        --list.count;
+        return block;
+    }
+    // 从list摘n块还给仓库
+    static void _give_back(__TCacheList& list, size_t c, size_t n) {
+        Depot& depot = _depot();
+        lock_guard<mutex> lock(depot.lock);
+        for (; n > 0; --n) _push(depot.lists[c], _pop(list));
+    }
+    // 给list补一批：仓库有就从仓库拿，否则新切一块
+    static void _refill(__TCacheList& list, size_t c) {
+        {
+            Depot& depot = _depot();
+            lock_guard<mutex> lock(depot.lock);
+            for (size_t n=0; n<mystl::__tcache_batch && depot.lists[c].count > 0; ++n)
+                _push(list, _pop(depot.lists[c]));
+        }
+        if (list.count > 0) return;
+        size_t block_size = SizeClass::block_size(c);
+        char* chunk = (char*)FirstAlloc::allocate(block_size * mystl::__tcache_batch);
+        for (size_t n=0; n<mystl::__tcache_batch; ++n) _push(list, chunk + n * block_size);
+    }
+
+public:
+    static void* allocate(size_t c) {
+        _touch_flusher();
+        Cache& cache = _cache();
+        if (cache.dead) {                   // 线程正在退出
+            __TCacheList list = { nullptr, 0 };
+            _refill(list, c);
+            void* block = _pop(list);
+            if (list.count > 0) _give_back(list, c, list.count);
+            return block;
+        }
+        __TCacheList& list = cache.lists[c];
+        if (list.count == 0) _refill(list, c);
+        return _pop(list);
+    }
+    static void deallocate(void* block, size_t c) {
+        _touch_flusher();
+        Cache& cache = _cache();
+        if (cache.dead) {
+            __TCacheList list = { nullptr, 0 };
+            _push(list, block);
+            _give_back(list, c, 1);
+            return;
+        }
+        __TCacheList& list = cache.lists[c];
+        _push(list, block);
+        if (list.count >= 2 * mystl::__tcache_batch) _give_back(list, c, mystl::__tcache_batch);
+    }
+};
+
+
+// """跳表节点"""
+// 【键、值发布后不再修改；next实际有height个，随节点一起分配】
+template <class Key, class Value>
+struct __SkipListNode {
+    typedef atomic<uintptr_t> Link;     // 后继指针，最低位为删除标记
+    static const unsigned char __inserted = 1;  // 各层都已接入（或放弃接入）
+    static const unsigned char __erased = 2;    // 已被删除
+    Key                     key;
+    Value                   value;
+    int                     height;
+    atomic<unsigned char>   state;
+    Link                    next[1];
+    __SkipListNode(const Key& k, const Value& v, int h): key(k), value(v), height(h), state(0) {
+        for (int level=0; level<h; ++level) new (next+level) Link(0);
+    }
+    // 塔高为height的节点所占的字节数，即线程缓存池第height-1类的块大小
+    static size_t block_size(size_t c) {
+        size_t bytes = sizeof(__SkipListNode) + c * sizeof(Link);
+        size_t align = alignof(__SkipListNode) < sizeof(void*) ? sizeof(void*) : alignof(__SkipListNode);
+        return (bytes + align - 1) / align * align;
+    }
+};
+
+// 计数器分片【独占一个缓存行】
+struct alignas(64) __SkipListCounter {
+    atomic<ptrdiff_t> n;
+    __SkipListCounter(): n(0) {}
+};
+
+
+// """并发跳表映射[Java ConcurrentSkipListMap]"""
+template <class Key, class Value, class KeyCompare = Compare<Key> >
+class ConcurrentSkipListMap {
+
+public:     // 【类型定义】
+    typedef Pair<Key, Value>    value_type;
+    typedef size_t              size_type;
+    typedef __SkipListNode<Key, Value>  Node;
+    typedef typename Node::Link         Link;
+    typedef __ThreadCachePool<Node, mystl::__skip_list_max_height> node_pool;
+    static const int __max_height = mystl::__skip_list_max_height;
+
+private:    // 【成员变量】
+    KeyCompare          _compare;
+    Link                _head[__max_height];        // 头节点的各层后继
+    __SkipListCounter   _counters[mystl::__n_counters];
+
+private:    // 【标记指针】
+    static Node* _ptr(uintptr_t link)   { return (Node*)(link & ~(uintptr_t)1); }
+    static bool _marked(uintptr_t link) { return (link & 1) != 0; }
+    // pred在level层的后继指针，pred为nullptr即头节点
+    Link& _link(Node* pred, int level) { return pred ? pred->next[level] : _head[level]; }
+    const Link& _link(const Node* pred, int level) const { return pred ? pred->next[level] : _head[level]; }
+
+private:    // 【节点的构造/释放】
+    static Node* _make_node(const Key& key, const Value& value, int height)
+        { return new (node_pool::allocate(height-1)) Node(key, value, height); }
+    static void _destroy_node(Node* node) {
+        int height = node->height;
+        node->~Node();
+        node_pool::deallocate(node, height-1);
+    }
+    static void _retire_node(void* node) { _destroy_node((Node*)node); }
+    void _count_add(ptrdiff_t delta)
+        { _counters[mystl::__skip_list_counter_slot()].n.fetch_add(delta, memory_order_relaxed); }
+
+private:    // 【查】
+    // 写者用的查找：求各层上最后一个键<key的节点preds[]及其后继succs[]，返回第0层是否找到key
+    // 沿途遇到带删除标记的节点就CAS摘下，CAS失败（前驱也变了）则从头再找；调用者须在epoch临界区内
+    template <class K>
+    bool _search(const K& key, Node** preds, Node** succs) {
+        while (true) {
+            bool retry = false;
+            Node* pred = nullptr;
+            for (int level = __max_height-1; level >= 0 && !retry; --level) {
+                Node* cur = _ptr(_link(pred, level).load(memory_order_acquire));
+                while (cur) {
+                    uintptr_t succ = cur->next[level].load(memory_order_acquire);
+                    if (_marked(succ)) {
+                        uintptr_t expected = (uintptr_t)cur;
+                        if (!_link(pred, level).compare_exchange_strong(expected, succ & ~(uintptr_t)1,
+                                                                        memory_order_release, memory_order_relaxed))
+                            { retry = true;  break; }
+                        cur = _ptr(succ);
+                        continue;
+                    }
+                    if (_compare(cur->key, key) >= 0) break;
+                    pred = cur;
+                    cur = _ptr(succ);
+                }
+                preds[level] = pred;
+                succs[level] = cur;
+            }
+            if (!retry) return succs[0] && _compare(succs[0]->key, key) == 0;
+        }
+    }
+    // 读者用的查找：第一个键>=key且未被删除的节点，不修改任何指针【带删除标记的节点只是跳过，其next仍可走】
+    template <class K>
+    const Node* _lower_bound(const K& key) const {
+        const Node* pred = nullptr;
+        const Node* cur = nullptr;
+        for (int level = __max_height-1; level >= 0; --level) {
+            cur = _ptr(_link(pred, level).load(memory_order_acquire));
+            while (cur) {
+                uintptr_t succ = cur->next[level].load(memory_order_acquire);
+                if (_marked(succ)) { cur = _ptr(succ);  continue; }
+                if (_compare(cur->key, key) >= 0) break;
+                pred = cur;
+                cur = _ptr(succ);
+            }
+        }
+        return cur;
+    }
+    template <class K>
+    const Node* _find_node(const K& key) const {
+        const Node* node = _lower_bound(key);
+        return node && _compare(node->key, key) == 0 ? node : nullptr;
+    }
+    // 第0层上从link起第一个未被删除的节点
+    static const Node* _first_alive(uintptr_t link) {
+        for (const Node* node = _ptr(link); node; node = _ptr(link)) {
+            link = node->next[0].load(memory_order_acquire);
+            if (!_marked(link)) return node;
+        }
+        return nullptr;
+    }
+    const Node* _front() const { return _first_alive(_head[0].load(memory_order_acquire)); }
+    static const Node* _next_alive(const Node* node) { return _first_alive(node->next[0].load(memory_order_acquire)); }
+    // 把已删除（各层都带标记）的node从它所在的每一层摘下
+    // 不能只靠_search(node->key)：它停在第一个未删除的同键节点上，而在上层，node可能排在同键的新塔之后
+    // （新塔查找时node在该层还没被标记，后来就接在了它前面），于是每层都要越过全部同键节点、按地址认出node
+    // 同键节点在各层的先后未必一致，故逐层下降时只带着最后一个键<key的前驱，同键的部分每层单独扫
+    void _unlink(Node* node) {
+        const Key& key = node->key;
+        while (true) {
+            bool retry = false;
+            Node* pred = nullptr;
+            for (int level = __max_height-1; level >= 0 && !retry; --level) {
+                Node* cur = _ptr(_link(pred, level).load(memory_order_acquire));
+                Node* prev = pred;          // 扫同键部分时的前驱，可能是同键的其他节点
+                while (cur) {
+                    uintptr_t succ = cur->next[level].load(memory_order_acquire);
+                    if (_marked(succ)) {    // 带标记的一律摘下，node自己也是这样摘下的
+                        uintptr_t expected = (uintptr_t)cur;
+                        if (!_link(prev, level).compare_exchange_strong(expected, succ & ~(uintptr_t)1,
+                                                                        memory_order_release, memory_order_relaxed))
+                            { retry = true;  break; }
+                        cur = _ptr(succ);
+                        continue;
+                    }
+                    int cmp = _compare(cur->key, key);
+                    if (cmp > 0 || (cmp == 0 && level >= node->height)) break;
+                    if (cmp < 0) pred = cur;
+                    prev = cur;
+                    cur = _ptr(succ);
+                }
+            }
+            if (!retry) return;
+        }
+    }
+    // 插入与删除都完成后，由后完成的一方把node从各层摘下并退休
+    void _unlink_and_retire(Node* node) {
+        _unlink(node);
+        mystl::epoch_retire(node, _retire_node);
+    }
+
+public:     // 【构造/析构函数】
+    ConcurrentSkipListMap() {
+        for (int level=0; level<__max_height; ++level) _head[level].store(0, memory_order_relaxed);
+    }
+    ConcurrentSkipListMap(initializer_list<value_type> init_list) {
+        for (int level=0; level<__max_height; ++level) _head[level].store(0, memory_order_relaxed);
+        for (const auto& item : init_list) insert(item.first, item.second);
+    }
+    // 析构时不能再有其他线程访问；已退休的节点由epoch机制释放
+    ~ConcurrentSkipListMap() {
+        for (Node *cur = _ptr(_head[0].load(memory_order_relaxed)), *next; cur; cur = next) {
+            next = _ptr(cur->next[0].load(memory_order_relaxed));
+            _destroy_node(cur);
+        }
+    }
+private:
+    ConcurrentSkipListMap(const ConcurrentSkipListMap&);
+    ConcurrentSkipListMap& operator=(const ConcurrentSkipListMap&);
+
+public:     // 【Basic Accessor】
+    // 各分片计数之和，有并发写时只是近似值
+    size_type size() const {
+        ptrdiff_t n = 0;
+        for (size_type i=0; i<mystl::__n_counters; ++i) n += _counters[i].n.load(memory_order_relaxed);
+        return n > 0 ? (size_type)n : 0;
+    }
+    bool empty() const {
+        EpochGuard guard;
+        return _front() == nullptr;
+    }
+
+public:     // 【查】不加锁
+    // 找到则把值拷贝到value并返回true
+    bool find(const Key& key, Value& value) const {
+        EpochGuard guard;
+        const Node* node = _find_node(key);
+        if (node) value = node->value;
+        return node != nullptr;
+    }
+    bool contains(const Key& key) const {
+        EpochGuard guard;
+        return _find_node(key) != nullptr;
+    }
+    size_type count(const Key& key) const { return contains(key) ? 1 : 0; }
+    // 最小的键值对，空时返回false
+    bool front(Key& key, Value& value) const {
+        EpochGuard guard;
+        const Node* node = _front();
+        if (node) { key = node->key;  value = node->value; }
+        return node != nullptr;
+    }
+    // 第一个键>=key的键值对，没有则返回false
+    bool lower_bound(const Key& key, Key& found_key, Value& value) const {
+        EpochGuard guard;
+        const Node* node = _lower_bound(key);
+        if (node) { found_key = node->key;  value = node->value; }
+        return node != nullptr;
+    }
+    // 透明查找：KeyCompare声明了is_transparent时，可直接以const char*/StringView等查找
+    template <class K, class = typename __TransparentKey<KeyCompare, KeyCompare, K>::type>
+    bool find(const K& key, Value& value) const {
+        EpochGuard guard;
+        const Node* node = _find_node(key);
+        if (node) value = node->value;
+        return node != nullptr;
+    }
+    template <class K, class = typename __TransparentKey<KeyCompare, KeyCompare, K>::type>
+    bool contains(const K& key) const {
+        EpochGuard guard;
+        return _find_node(key) != nullptr;
+    }
+
+public:     // 【遍历】在临界区内按键的升序调用func(key, value)；与并发写同时进行时只保证弱一致性
+    template <class Function>
+    void for_each(Function func) const {
+        EpochGuard guard;
+        for (const Node* cur = _front(); cur; cur = _next_alive(cur))
+            func(cur->key, cur->value);
+    }
+    // 只遍历键在[lo, hi]内的
+    template <class Function>
+    void for_each_range(const Key& lo, const Key& hi, Function func) const {
+        EpochGuard guard;
+        for (const Node* cur = _lower_bound(lo); cur && _compare(cur->key, hi) <= 0; cur = _next_alive(cur))
+            func(cur->key, cur->value);
+    }
+
+public:     // 【增】
+    // 键不存在时插入，返回是否插入
+    bool insert(const Key& key, const Value& value) {
+        EpochGuard guard;
+        Node* preds[__max_height];
+        Node* succs[__max_height];
+        int height = mystl::__skip_list_random_height();
+        Node* node = nullptr;
+        while (true) {                      // 第0层接入成功即插入完成
+            if (_search(key, preds, succs)) {
+                if (node) _destroy_node(node);      // 尚未发布，可直接释放
+                return false;
+            }
+            if (!node) node = _make_node(key, value, height);
+            for (int level=0; level<height; ++level)
+                node->next[level].store((uintptr_t)succs[level], memory_order_relaxed);
+            uintptr_t expected = (uintptr_t)succs[0];
+            if (_link(preds[0], 0).compare_exchange_strong(expected, (uintptr_t)node,
+                                                           memory_order_release, memory_order_relaxed))
+                break;
+        }
+        _count_add(1);
+        // 自底向上逐层接入；节点在此期间被删除（next带了标记）就不再接
+        bool erased = false;
+        for (int level = 1; level < height && !erased; ++level) {
+            while (true) {
+                uintptr_t next = node->next[level].load(memory_order_acquire);
+                if (_marked(next)) { erased = true;  break; }
+                Node* succ = succs[level];
+                // 后继在该层已带标记（可能就是刚删除的同键旧塔）就不接在它前面，重新查找时会先把它摘下
+                if (!succ || !_marked(succ->next[level].load(memory_order_acquire))) {
+                    if (next != (uintptr_t)succ &&          // 尚未接入的层只有删除者会改（打标记）
+                        !node->next[level].compare_exchange_strong(next, (uintptr_t)succ,
+                                                                   memory_order_release, memory_order_relaxed))
+                        { erased = true;  break; }
+                    uintptr_t expected = (uintptr_t)succ;
+                    if (_link(preds[level], level).compare_exchange_strong(expected, (uintptr_t)node,
+                                                                           memory_order_release, memory_order_relaxed))
+                        break;
+                }
+                if (!_search(key, preds, succs) || succs[0] != node) { erased = true;  break; }
+            }
+        }
+        if (node->state.fetch_or(Node::__inserted, memory_order_acq_rel) & Node::__erased)
+            _unlink_and_retire(node);
+        return true;
+    }
+
+public:     // 【删】
+    // 返回删除的节点数（0或1）
+    size_type erase(const Key& key) {
+        EpochGuard guard;
+        Node* preds[__max_height];
+        Node* succs[__max_height];
+        if (!_search(key, preds, succs)) return 0;
+        Node* node = succs[0];
+        for (int level = node->height-1; level >= 1; --level)     // 自顶向下打标记
+            node->next[level].fetch_or(1, memory_order_acq_rel);
+        uintptr_t next = node->next[0].load(memory_order_acquire);
+        do {
+            if (_marked(next)) return 0;    // 别的线程抢先删除了
+        } while (!node->next[0].compare_exchange_weak(next, next | 1, memory_order_acq_rel, memory_order_acquire));
+        _count_add(-1);
+        if (node->state.fetch_or(Node::__erased, memory_order_acq_rel) & Node::__inserted)
+            _unlink_and_retire(node);
+        return 1;
+    }
+
+};
+
+// cout << skip_list_map;
+template <class Key, class Value, class KeyCompare>
+ostream& operator<<(ostream& out, const ConcurrentSkipListMap<Key, Value, KeyCompare>& skip_list_map) {
+    out << "{ ";
+    skip_list_map.for_each([&out](const Key& key, const Value& value) { out << key << ": " << value << ", "; });
+    return out << "}";
+}
+
+
+#endif // __CONCURRENT_SKIP_LIST_MAP__
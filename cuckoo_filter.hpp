@@ -0,0 +1,209 @@
+/* cuckoo_filter.hpp
+ * 【布谷鸟过滤器】与布隆过滤器一样判断“一定不存在/可能存在”，但支持删除
+ * 参考Fan等人的Cuckoo Filter: Practically Better Than Bloom(2014)
+ *
+ * 结构：
+ * (1)只存键的16位指纹(fingerprint)，每个桶4个槽位恰好是一个uint64_t，桶数为2的幂
+ * (2)指纹可以放在两个候选桶之一：i1 = hash & mask，i2 = i1 ^ (指纹的哈希 & mask)
+ *    由任一候选桶和指纹都能算出另一个（异或是自反的），故不必存原键就能把指纹踢到另一个桶
+ * (3)两个桶都满时随机踢出一个指纹，让它去自己的另一个桶，如此接力至多__cuckoo_max_kicks次（布谷鸟哈希）
+ * (4)查找只看两个桶：把指纹复制到4个16位通道，与桶异或后用SWAR“有无全零通道”的技巧一次判断（一个uint64_t内的SIMD）
+ * (5)装载率可达95%，每键约17位；误判率约 8/65536 ≈ 0.012%
+ *
+ * 注意：
+ * (1)erase()只能删除确实插入过的键，否则可能删掉另一个键的同值指纹，造成漏判
+ * (2)同一个键插入k次会占k个槽位，删除k次才真正删掉
+ * (3)踢了__cuckoo_max_kicks次仍无处安放时，最后被踢出的指纹暂存在victim里，此后insert()一律失败（返回false）
+ */
+#ifndef __CUCKOO_FILTER__
+#define __CUCKOO_FILTER__
+#include <iostream>
+#include <cstring>      // memcpy()
+#include <cstdint>      // uint16_t, uint64_t
+#include "alloc.hpp"
+#include "utils.hpp"
+using namespace std;
+
+
+static const size_t   __cuckoo_slots = 4;           // 每桶的槽位数
+static const size_t   __cuckoo_max_kicks = 500;     // 插入时至多踢出的次数
+static const uint64_t __cuckoo_lanes = 0x0001000100010001ULL;
+
+
+// """布谷鸟过滤器"""
+template <class Key, class KeyHasher = HashCode<Key> >
+class CuckooFilter {
+
+public:     // 【类型定义】
+    typedef Key                 key_type;
+    typedef size_t              size_type;
+
+private:    // 【成员变量】
+    KeyHasher   _hasher;
+    uint64_t*   _buckets;       // 每个桶4个16位指纹，0即空槽
+    size_type   _mask;          // 桶数-1
+    size_type   _size;
+    uint64_t    _rand;          // 踢出时选槽位用的xorshift状态
+    uint16_t    _victim;        // 无处安放的指纹，0即没有
+    size_type   _victim_index;
+
+private:    // 【哈希与指纹】
+    static uint64_t _mix(uint64_t h) {
+        h ^= h >> 33;  h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;  h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+    // 低位选桶，高16位作指纹（避开空槽的0）
+    template <class K>
+    void _locate(const K& key, size_type& index, uint16_t& fp) const {
+        uint64_t h = _mix(_hasher(key));
+        index = (size_type)h & _mask;
+        fp = (uint16_t)(h >> 48);
+        if (fp == 0) fp = 1;
+    }
+    size_type _alt_index(size_type index, uint16_t fp) const
+        { return (index ^ (size_type)(fp * 0x5bd1e995ULL)) & _mask; }
+    static uint16_t _slot(uint64_t bucket, size_type i) { return (uint16_t)(bucket >> (16*i)); }
+    static void _set_slot(uint64_t& bucket, size_type i, uint16_t fp)
+        { bucket = (bucket & ~(0xffffULL << (16*i))) | ((uint64_t)fp << (16*i)); }
+    // 桶里值为fp的通道：对应通道的最高位为1【异或后全零的通道即相等的通道】
+    // “有没有”的判断是精确的；借位可能误标真正相等的通道上方的通道，但最低的被标通道一定真的相等
+    static uint64_t _match(uint64_t bucket, uint16_t fp) {
+        uint64_t x = bucket ^ (__cuckoo_lanes * fp);
+        return (x - __cuckoo_lanes) & ~x & (__cuckoo_lanes << 15);
+    }
+    static size_type _lowest_lane(uint64_t mask) {
+        size_type lane = 0;
+        while (!(mask & 0x8000ULL)) { mask >>= 16;  ++lane; }
+        return lane;
+    }
+    // 放进桶index的空槽，桶满则返回false
+    bool _put(size_type index, uint16_t fp) {
+        uint64_t empty = _match(_buckets[index], 0);
+        if (!empty) return false;
+        _set_slot(_buckets[index], _lowest_lane(empty), fp);
+        return true;
+    }
+    // 从桶index删掉一个值为fp的槽，没有则返回false
+    bool _remove(size_type index, uint16_t fp) {
+        uint64_t found = _match(_buckets[index], fp);
+        if (!found) return false;
+        _set_slot(_buckets[index], _lowest_lane(found), 0);
+        return true;
+    }
+    uint64_t _next_rand() {
+        _rand ^= _rand << 13;  _rand ^= _rand >> 7;  _rand ^= _rand << 17;
+        return _rand;
+    }
+    // 放入指纹fp（候选桶之一为index），成功返回true；失败时最后被踢出的指纹存入victim
+    bool _insert(size_type index, uint16_t fp) {
+        size_type alt = _alt_index(index, fp);
+        if (_put(index, fp) || _put(alt, fp)) return true;
+        if (_next_rand() & 1) index = alt;
+        for (size_type kick=0; kick < __cuckoo_max_kicks; ++kick) {
+            size_type slot = (size_type)(_next_rand() % __cuckoo_slots);
+            uint16_t evicted = _slot(_buckets[index], slot);
+            _set_slot(_buckets[index], slot, fp);
+            fp = evicted;
+            index = _alt_index(index, fp);
+            if (_put(index, fp)) return true;
+        }
+        _victim = fp;
+        _victim_index = index;
+        return false;
+    }
+
+public:     // 【构造/析构函数】
+    // 预计存放capacity个键（按95%装载率留出空间，桶数取2的幂）
+    explicit CuckooFilter(size_type capacity = 1024): _size(0), _rand(0x2545F4914F6CDD1DULL), _victim(0), _victim_index(0) {
+        size_type n_buckets = 1;
+        while (n_buckets * __cuckoo_slots * 95 < capacity * 100) n_buckets <<= 1;
+        _mask = n_buckets - 1;
+        _buckets = (uint64_t*)FirstAlloc::clallocate(n_buckets, sizeof(uint64_t));
+    }
+    CuckooFilter(const CuckooFilter& other):
+        _hasher(other._hasher), _mask(other._mask), _size(other._size), _rand(other._rand),
+        _victim(other._victim), _victim_index(other._victim_index) {
+        _buckets = (uint64_t*)FirstAlloc::allocate((_mask+1) * sizeof(uint64_t));
+        memcpy(_buckets, other._buckets, (_mask+1) * sizeof(uint64_t));
+    }
+    CuckooFilter& operator=(const CuckooFilter& other) {
+        if (this != &other) {
+            CuckooFilter copy(other);
+            swap(copy);
+        }
+        return *this;
+    }
+    ~CuckooFilter() { FirstAlloc::deallocate(_buckets); }
+    void swap(CuckooFilter& other) {
+        std::swap(_hasher, other._hasher);  std::swap(_buckets, other._buckets);
+        std::swap(_mask, other._mask);      std::swap(_size, other._size);
+        std::swap(_rand, other._rand);      std::swap(_victim, other._victim);
+        std::swap(_victim_index, other._victim_index);
+    }
+
+public:     // 【Basic Accessor】
+    size_type size()        const { return _size; }
+    // 按95%装载率能放下的键数
+    size_type capacity()    const { return (_mask+1) * __cuckoo_slots * 95 / 100; }
+    double load_factor()    const { return (double)_size / ((_mask+1) * __cuckoo_slots); }
+    bool full()             const { return _victim != 0; }
+    void clear() {
+        memset(_buckets, 0, (_mask+1) * sizeof(uint64_t));
+        _size = 0;
+        _victim = 0;
+    }
+
+public:     // 【增、查、删】
+    // 过滤器已满则返回false，此时key没有放入
+    bool insert(const Key& key) {
+        if (_victim) return false;
+        size_type index;  uint16_t fp;
+        _locate(key, index, fp);
+        _insert(index, fp);             // 即使失败，key的指纹也已放入，只是另一个指纹暂存在victim里
+        ++_size;
+        return true;
+    }
+    // 返回false即一定不存在；返回true即可能存在
+    bool might_contain(const Key& key) const {
+        size_type index;  uint16_t fp;
+        _locate(key, index, fp);
+        size_type alt = _alt_index(index, fp);
+        return _match(_buckets[index], fp) || _match(_buckets[alt], fp) ||
+               (_victim == fp && (_victim_index == index || _victim_index == alt));
+    }
+    // 透明查找：KeyHasher声明了is_transparent时，可直接以const char*/StringView等查询，不构造临时Key
+    template <class K, class = typename __TransparentKey<KeyHasher, KeyHasher, K>::type>
+    bool might_contain(const K& key) const {
+        size_type index;  uint16_t fp;
+        _locate(key, index, fp);
+        size_type alt = _alt_index(index, fp);
+        return _match(_buckets[index], fp) || _match(_buckets[alt], fp) ||
+               (_victim == fp && (_victim_index == index || _victim_index == alt));
+    }
+    // 删除一个插入过的键，返回是否找到其指纹
+    bool erase(const Key& key) {
+        size_type index;  uint16_t fp;
+        _locate(key, index, fp);
+        size_type alt = _alt_index(index, fp);
+        if (_remove(index, fp) || _remove(alt, fp)) {
+            --_size;
+            if (_victim) {              // 腾出了槽位，把暂存的指纹重新放回去
+                uint16_t victim = _victim;
+                _victim = 0;
+                _insert(_victim_index, victim);
+            }
+            return true;
+        }
+        if (_victim == fp && (_victim_index == index || _victim_index == alt)) {
+            _victim = 0;
+            --_size;
+            return true;
+        }
+        return false;
+    }
+};
+
+
+#endif // __CUCKOO_FILTER__
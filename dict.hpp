@@ -0,0 +1,347 @@
+/* dict.hpp
+ * 【有序紧凑字典】按插入顺序遍历的哈希映射，参考CPython 3.6起的compact dict
+ *
+ * 结构：
+ * (1)条目数组entries：按插入顺序紧密存放{键, 值}，遍历即顺序扫描
+ * (2)稀疏索引数组index：开放寻址的哈希表，每格只存条目的下标（-1为空，-2为已删除）
+ *    每格的宽度随表长变化：表长<=128用int8，<=2^15用int16，<=2^31用int32，否则int64
+ *    于是稀疏部分每格只占1~8字节，键值对本身只存一份且紧密排列
+ * (3)表长是2的幂，且不小于条目数组容量的1.5倍（负载因子<=2/3，已删除的格也算在内）；
+ *    探测序列同CPython：i = 5*i + perturb + 1，perturb >>= 5
+ * (4)条目数组按1.5倍增长，与索引分开扩容：索引表长不变且没有已删除的条目时，只需搬动条目，不必重建索引
+ * (5)删除只析构键值、在位图_dead中标记该条目、索引格置为-2；
+ *    条目数组用满时才一次性紧缩掉已删除的条目，并按存活条目数重建索引（可能扩容也可能缩容）
+ *
+ * 与CPython不同，条目里不存哈希值：<long, long>每个条目16字节而不是24字节，
+ * 代价是探测时每遇到一个下标都要比较一次键，重建索引时要重新计算哈希值
+ *
+ * 注意：
+ * (1)覆盖已有键的值不改变其位置；删除后再插入则排到最后
+ * (2)紧缩/扩容会挪动条目，之前的迭代器、元素指针全部失效
+ */
+#ifndef __DICT__
+#define __DICT__
+#include <initializer_list>
+#include <iostream>
+#include <cstring>      // memset()
+#include <cstdint>      // int8_t, int16_t, int32_t, int64_t
+#include <new>          // placement new
+#include <utility>      // move()
+#include "alloc.hpp"
+#include "utils.hpp"
+using namespace std;
+
+
+static const int64_t __dict_ix_empty = -1;              // 索引格：空
+static const int64_t __dict_ix_dummy = -2;              // 索引格：已删除（探测时不能停）
+
+
+// 条目【it->key，it->value】
+template <class Key, class Value>
+struct __DictEntry {
+    Key     key;
+    Value   value;
+};
+
+
+// 迭代器：顺序扫描条目数组，跳过已删除的条目
+template <class DictType>
+struct __DictIterator {
+    // 类型定义
+    typedef ForwardIteratorTag                  iterator_category;  // 前向迭代器
+    typedef typename DictType::entry_type       Entry;
+    typedef Entry                               value_type;
+    typedef Entry*                              pointer;
+    typedef Entry&                              reference;
+    typedef size_t                              size_type;
+    typedef ptrdiff_t                           difference_type;
+    typedef __DictIterator<DictType>            iterator;
+    // 成员变量
+    const DictType* dict;
+    size_type       pos;        // 条目下标，pos == 已用条目数即end()
+    // 构造函数
+    __DictIterator(): dict(nullptr), pos(0) {}
+    __DictIterator(const DictType* d, size_type position): dict(d), pos(position) {}
+    // *self, ->self, self==other, self!=other
+    Entry& operator*()  const { return dict->_entries[pos]; }
+    Entry* operator->() const { return dict->_entries + pos; }
+    bool operator==(const iterator& other) const { return pos == other.pos; }
+    bool operator!=(const iterator& other) const { return pos != other.pos; }
+    // ++self, self++
+    iterator& operator++()
+        { pos = dict->_next_alive(pos+1);  return *this; }
+    iterator operator++(int)
+        { iterator tmp(*this);  pos = dict->_next_alive(pos+1);  return tmp; }
+};
+
+
+// """有序紧凑字典[python dict]"""
+template <class Key,
+          class Value,
+          class KeyHasher   = HashCode<Key>,
+          class KeyCompare  = Compare<Key>,
+          class Alloc       = FirstAlloc>
+class Dict {
+
+public:     // 【类型定义】
+    typedef Pair<Key, Value>    value_type;
+    typedef size_t              size_type;
+    typedef ptrdiff_t           difference_type;
+    typedef __DictEntry<Key, Value>     entry_type;
+    typedef Dict<Key, Value, KeyHasher, KeyCompare, Alloc>  self;
+    typedef __DictIterator<self>        iterator;
+    typedef Allocator<entry_type, Alloc>    entry_allocator;
+    typedef Allocator<char, Alloc>          index_allocator;
+    friend struct __DictIterator<self>;
+    static const size_type min_capacity = 8;
+
+private:    // 【成员变量】
+    KeyCompare      _compare;
+    KeyHasher       _hasher;
+    void*           _index;         // _index_size格，每格_index_width字节
+    size_type       _index_size;    // 0或2的幂
+    unsigned        _index_width;   // 1/2/4/8
+    entry_type*     _entries;       // 条目数组
+    uint64_t*       _dead;          // 位图，第i位为1即第i个条目已删除
+    size_type       _capacity;      // 条目数组容量
+    size_type       _used;          // 已用的条目数（含已删除）
+    size_type       _size;          // 存活的条目数
+
+private:    // 【哈希】
+    // 同FlatHashMap<>：再混合一次（murmur3的fmix64），低位与perturb的高位都足够均匀
+    template <class K>
+    size_type _hash(const K& key) const {
+        uint64_t h = (uint64_t)_hasher(key);
+        h ^= h >> 33;  h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;  h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return (size_type)h;
+    }
+    bool _is_dead(size_type pos) const { return (_dead[pos >> 6] >> (pos & 63)) & 1; }
+
+private:    // 【稀疏索引】
+    static unsigned _width_for(size_type index_size) {
+        if (index_size <= 0x80) return 1;
+        if (index_size <= 0x8000) return 2;
+        if (index_size <= 0x80000000UL) return 4;
+        return 8;
+    }
+    int64_t _get_ix(size_type i) const {
+        switch (_index_width) {
+            case 1:  return ((const int8_t*)_index)[i];
+            case 2:  return ((const int16_t*)_index)[i];
+            case 4:  return ((const int32_t*)_index)[i];
+            default: return ((const int64_t*)_index)[i];
+        }
+    }
+    void _set_ix(size_type i, int64_t ix) {
+        switch (_index_width) {
+            case 1:  ((int8_t*)_index)[i]  = (int8_t)ix;   break;
+            case 2:  ((int16_t*)_index)[i] = (int16_t)ix;  break;
+            case 4:  ((int32_t*)_index)[i] = (int32_t)ix;  break;
+            default: ((int64_t*)_index)[i] = ix;           break;
+        }
+    }
+    // 能容纳capacity个条目（负载因子<=2/3）的最小表长
+    static size_type _index_size_for(size_type capacity) {
+        size_type index_size = 2 * min_capacity;
+        while (index_size * 2 / 3 < capacity) index_size *= 2;
+        return index_size;
+    }
+    // 探测序列中下一格
+    size_type _probe_next(size_type i, size_type& perturb) const {
+        perturb >>= 5;
+        return (i*5 + perturb + 1) & (_index_size-1);
+    }
+
+private:    // 【查】
+    // 查找键为key的索引格，不存在则返回_index_size
+    // K通常即Key，KeyHasher/KeyCompare透明时也可以是const char*、StringView等
+    template <class K>
+    size_type _lookup(const K& key, size_type hash) const {
+        if (_index_size == 0) return 0;
+        size_type perturb = hash;
+        for (size_type i = hash & (_index_size-1); ; i = _probe_next(i, perturb)) {
+            int64_t ix = _get_ix(i);
+            if (ix == __dict_ix_empty) return _index_size;
+            if (ix >= 0 && _compare(_entries[ix].key, key) == 0) return i;    // 已删除的条目在索引里是-2，不会比较到
+        }
+    }
+    // 第一个可放入新条目的索引格（空或已删除）
+    size_type _find_free(size_type hash) const {
+        size_type perturb = hash;
+        size_type i = hash & (_index_size-1);
+        while (_get_ix(i) >= 0) i = _probe_next(i, perturb);
+        return i;
+    }
+    size_type _next_alive(size_type pos) const {
+        while (pos < _used && _is_dead(pos)) ++pos;
+        return pos;
+    }
+
+private:    // 【紧缩/扩容】
+    // 把存活的条目按原顺序搬到容量为capacity的新数组里
+    // 有已删除的条目（下标会变）或表长变了才重建索引，重建时顺带清掉所有-2
+    void _rebuild(size_type capacity) {
+        size_type index_size = _index_size_for(capacity);
+        bool reindex = _used > _size || index_size != _index_size;
+        entry_type* new_entries = entry_allocator::allocate(capacity);
+        size_type n = 0;
+        for (size_type i=0; i<_used; ++i) {
+            if (_is_dead(i)) continue;          // 已删除的条目键值早已析构
+            new (new_entries+n) entry_type(std::move(_entries[i]));
+            _entries[i].~entry_type();
+            ++n;
+        }
+        entry_allocator::deallocate(_entries);
+        Allocator<uint64_t, Alloc>::deallocate(_dead);
+        _entries = new_entries;
+        _dead = Allocator<uint64_t, Alloc>::clallocate((capacity+63) / 64);
+        _capacity = capacity;
+        _used = n;
+        if (!reindex) return;
+        index_allocator::deallocate((char*)_index);
+        _index_size = index_size;
+        _index_width = _width_for(index_size);
+        _index = index_allocator::allocate(index_size * _index_width);
+        memset(_index, 0xFF, index_size * _index_width);         // 全部置为-1
+        for (size_type i=0; i<n; ++i)
+            _set_ix(_find_free(_hash(_entries[i].key)), (int64_t)i);
+    }
+    // 条目数组用满时调用：按存活条目数的1.5倍重建，删除多时即原地紧缩甚至缩容
+    void _grow() {
+        size_type capacity = _size + _size/2 + 1;
+        _rebuild(capacity > min_capacity ? capacity : min_capacity);
+    }
+    // 返回键为key的条目下标，不存在则在末尾追加一个（值初始化的）新条目
+    size_type _insert_entry(const Key& key) {
+        size_type hash = _hash(key);
+        size_type i = _lookup(key, hash);
+        if (i < _index_size) return (size_type)_get_ix(i);
+        if (_used == _capacity) _grow();
+        size_type pos = _used++;
+        new (_entries+pos) entry_type();
+        _entries[pos].key = key;
+        _set_ix(_find_free(hash), (int64_t)pos);
+        ++_size;
+        return pos;
+    }
+
+public:     // 【构造/析构函数】
+    Dict():
+        _index(nullptr), _index_size(0), _index_width(1), _entries(nullptr), _dead(nullptr), _capacity(0), _used(0), _size(0) {}
+    Dict(initializer_list<value_type> init_list):
+        _index(nullptr), _index_size(0), _index_width(1), _entries(nullptr), _dead(nullptr), _capacity(0), _used(0), _size(0) {
+        reserve(init_list.size());
+        for (const auto& item : init_list)
+            insert(item.first, item.second);
+    }
+    Dict(const Dict& other):
+        _index(nullptr), _index_size(0), _index_width(1), _entries(nullptr), _dead(nullptr), _capacity(0), _used(0), _size(0) {
+        reserve(other.size());
+        for (const entry_type& entry : other)
+            insert(entry.key, entry.value);
+    }
+    Dict& operator=(const Dict& other) {
+        if (this != &other) {
+            Dict copy(other);
+            this->swap(copy);
+        }
+        return *this;
+    }
+    ~Dict() {
+        clear();
+        entry_allocator::deallocate(_entries);
+        Allocator<uint64_t, Alloc>::deallocate(_dead);
+        index_allocator::deallocate((char*)_index);
+    }
+    void swap(Dict& other) {
+        std::swap(_compare, other._compare);        std::swap(_hasher, other._hasher);
+        std::swap(_index, other._index);            std::swap(_index_size, other._index_size);
+        std::swap(_index_width, other._index_width);
+        std::swap(_entries, other._entries);        std::swap(_dead, other._dead);
+        std::swap(_capacity, other._capacity);      std::swap(_used, other._used);
+        std::swap(_size, other._size);
+    }
+
+public:     // 【Basic Accessor】
+    size_type size()     const { return _size; }
+    size_type capacity() const { return _capacity; }
+    bool empty()         const { return _size == 0; }
+    iterator begin()     const { return iterator(this, _next_alive(0)); }
+    iterator end()       const { return iterator(this, _used); }
+    // 预留至少能容纳n个条目的空间（同时紧缩掉已删除的条目）
+    void reserve(size_type n) {
+        if (n > _capacity) _rebuild(n);
+    }
+
+public:     // 【增、改、查】
+    // 插入键值对，键已存在则覆盖其值（位置不变）
+    // 【先取得条目下标再访问_entries：_insert_entry()可能扩容】
+    void insert(const Key& key, const Value& value) {
+        size_type pos = _insert_entry(key);
+        _entries[pos].value = value;
+    }
+    // 键不存在时在末尾插入Value()
+    Value& operator[](const Key& key) {
+        size_type pos = _insert_entry(key);
+        return _entries[pos].value;
+    }
+    const Value& operator[](const Key& key) const {
+        size_type i = _lookup(key, _hash(key));
+        if (i >= _index_size) {
+            cerr << "warning: " << "key not found in Dict(at " << this << ")!" << endl;
+            static const Value default_value = Value();
+            return default_value;
+        }
+        return _entries[_get_ix(i)].value;
+    }
+    iterator find(const Key& key) const {
+        size_type i = _lookup(key, _hash(key));
+        return i < _index_size ? iterator(this, (size_type)_get_ix(i)) : end();
+    }
+    bool contains(const Key& key)   const { return _lookup(key, _hash(key)) < _index_size; }
+    size_type count(const Key& key) const { return contains(key) ? 1 : 0; }
+    // 透明查找：KeyHasher与KeyCompare都声明了is_transparent时，可直接以const char*/StringView等查找，不构造临时Key
+    template <class K, class = typename __TransparentKey<KeyHasher, KeyCompare, K>::type>
+    iterator find(const K& key) const {
+        size_type i = _lookup(key, _hash(key));
+        return i < _index_size ? iterator(this, (size_type)_get_ix(i)) : end();
+    }
+    template <class K, class = typename __TransparentKey<KeyHasher, KeyCompare, K>::type>
+    bool contains(const K& key)     const { return _lookup(key, _hash(key)) < _index_size; }
+    template <class K, class = typename __TransparentKey<KeyHasher, KeyCompare, K>::type>
+    size_type count(const K& key)   const { return contains(key) ? 1 : 0; }
+
+public:     // 【删】
+    // 删除键为key的条目，返回删除的个数（0或1）；条目只做标记，留到下次_rebuild()时紧缩
+    size_type erase(const Key& key) {
+        size_type i = _lookup(key, _hash(key));
+        if (i >= _index_size) return 0;
+        size_type pos = (size_type)_get_ix(i);
+        _entries[pos].~entry_type();
+        _dead[pos >> 6] |= uint64_t(1) << (pos & 63);
+        _set_ix(i, __dict_ix_dummy);
+        --_size;
+        return 1;
+    }
+    void clear() {
+        for (size_type i=0; i<_used; ++i)
+            if (!_is_dead(i)) _entries[i].~entry_type();
+        if (_index) memset(_index, 0xFF, _index_size * _index_width);
+        if (_dead) memset(_dead, 0, (_capacity+63) / 64 * sizeof(uint64_t));
+        _used = 0;
+        _size = 0;
+    }
+};
+
+// cout << dict;
+template <class Key, class Value, class KeyHasher, class KeyCompare, class Alloc>
+ostream& operator<<(ostream& out, const Dict<Key, Value, KeyHasher, KeyCompare, Alloc>& dict) {
+    out << "{ ";
+    for (const auto& entry : dict) out << entry.key << ": " << entry.value << ", ";
+    return out << "}";
+}
+
+
+#endif // __DICT__
@@ -0,0 +1,194 @@
+/* epoch.hpp
+ * 【基于epoch的内存回收(EBR, epoch-based reclamation)】供无锁读的并发容器使用
+ * 读者不加锁地遍历链表/数组时，写者摘下的节点不能立即释放 —— 可能还有读者正停在上面
+ * 写者把它“退休(retire)”，等所有可能看到它的读者都离开后再真正释放
+ *
+ * 原理（参考Fraser的EBR以及crossbeam-epoch）：
+ * (1)全局epoch单调递增；每个线程进入临界区时记下当时的全局epoch（pin），离开时清除（unpin）
+ * (2)退休的对象以退休时的全局epoch为标记，放进本线程的三个“垃圾袋”之一（epoch % 3）
+ * (3)所有处于临界区的线程都已记下当前全局epoch e时，全局epoch才能推进到e+1；
+ *    于是全局epoch推进到e+2后，退休时标记为e的对象不可能再被任何读者引用，可以释放
+ *
+ * 用法：
+ * {
+ *     EpochGuard guard;            // 进入临界区，作用域内读到的指针都不会被释放
+ *     Node* node = head.load();
+ *     ...
+ * }
+ * mystl::epoch_retire(node, deleter); // 摘下node后退休，由deleter(node)在安全时释放
+ *
+ * 注意：
+ * (1)临界区可以嵌套，但不要在临界区内阻塞太久，否则全局epoch无法推进，垃圾会一直堆积
+ * (2)线程退出时未到期的垃圾留在它的线程记录里，由之后复用该记录的线程释放
+ */
+#ifndef __EPOCH__
+#define __EPOCH__
+#include <atomic>       // atomic<>, atomic_thread_fence()
+#include <cstdint>      // uint64_t
+#include <new>          // placement new
+#include <cstdio>       // perror()【alloc.hpp要用，它自己没有包含】
+#include <cstdlib>      // malloc(), exit()
+#include "alloc.hpp"
+using namespace std;
+
+
+namespace mystl {
+    static const size_t __epoch_scan_interval = 64;     // 每退休64个对象尝试推进一次全局epoch
+
+    // 一个退休的对象
+    struct __EpochRetired {
+        void*   ptr;
+        void  (*deleter)(void*);
+    };
+    // 垃圾袋：同一epoch退休的对象
+    struct __EpochBag {
+        __EpochRetired* items;
+        size_t          size;
+        size_t          capacity;
+        uint64_t        epoch;
+    };
+
+    // 线程记录，串成一条只增不删的全局链表；线程退出时释放记录（in_use = false）供后来的线程复用
+    struct __EpochRecord {
+        atomic<uint64_t>    state;      // (epoch<<1)|1即在临界区内且记下了epoch，0即不在临界区
+        atomic<bool>        in_use;
+        __EpochRecord*      next;
+        // 以下只由持有该记录的线程访问
+        unsigned            depth;      // 临界区嵌套层数
+        size_t              retired;    // 上次尝试推进后退休的对象数
+        __EpochBag          bags[3];
+        __EpochRecord(): state(0), in_use(true), next(nullptr), depth(0), retired(0) {
+            for (int i=0; i<3; ++i) { bags[i].items = nullptr;  bags[i].size = bags[i].capacity = 0;  bags[i].epoch = 0; }
+        }
+    };
+
+    struct __EpochDomain {
+        atomic<uint64_t>        epoch;
+        atomic<__EpochRecord*>  records;
+    };
+    inline __EpochDomain& __epoch_domain() {
+        static __EpochDomain domain;        // 静态存储期，零初始化
+        return domain;
+    }
+
+    // 复用一个空闲的线程记录，没有则新建并挂到链表头
+    inline __EpochRecord* __epoch_acquire_record() {
+        __EpochDomain& domain = __epoch_domain();
+        for (__EpochRecord* rec = domain.records.load(memory_order_acquire); rec; rec = rec->next) {
+            bool expected = false;
+            if (!rec->in_use.load(memory_order_relaxed) &&
+                rec->in_use.compare_exchange_strong(expected, true, memory_order_acquire))
+                return rec;
+        }
+        __EpochRecord* rec = new (FirstAlloc::allocate(sizeof(__EpochRecord))) __EpochRecord();
+        __EpochRecord* head = domain.records.load(memory_order_relaxed);
+        do { rec->next = head; }
+        while (!domain.records.compare_exchange_weak(head, rec, memory_order_release, memory_order_relaxed));
+        return rec;
+    }
+
+    // 释放整袋垃圾【先把袋子摘下再调用deleter，deleter内部再退休对象也不会破坏正在遍历的数组】
+    inline void __epoch_free_bag(__EpochBag& bag) {
+        __EpochRetired* items = bag.items;
+        size_t size = bag.size;
+        bag.items = nullptr;
+        bag.size = bag.capacity = 0;
+        for (size_t i=0; i<size; ++i) items[i].deleter(items[i].ptr);
+        Allocator<__EpochRetired>::deallocate(items);
+    }
+
+    // 所有在临界区内的线程都记下了当前全局epoch时，把全局epoch推进一步
+    inline void __epoch_try_advance() {
+        __EpochDomain& domain = __epoch_domain();
+        uint64_t epoch = domain.epoch.load(memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);  // 与__epoch_pin()的fence配对
+        for (__EpochRecord* rec = domain.records.load(memory_order_acquire); rec; rec = rec->next) {
+            uint64_t state = rec->state.load(memory_order_relaxed);
+            if ((state & 1) && (state >> 1) != epoch) return;
+        }
+        atomic_thread_fence(memory_order_acquire);
+        domain.epoch.compare_exchange_strong(epoch, epoch+1, memory_order_release, memory_order_relaxed);
+    }
+
+    // 释放本线程已到期（全局epoch比标记大2以上）的垃圾
+    inline void __epoch_collect(__EpochRecord* rec) {
+        uint64_t epoch = __epoch_domain().epoch.load(memory_order_acquire);
+        for (int i=0; i<3; ++i)
+            if (rec->bags[i].size > 0 && epoch - rec->bags[i].epoch >= 2)
+                __epoch_free_bag(rec->bags[i]);
+    }
+
+    // 每个线程一份的记录句柄，线程退出时归还
+    struct __EpochThread {
+        __EpochRecord* rec;
+        __EpochThread(): rec(__epoch_acquire_record()) {}
+        ~__EpochThread() {
+            __epoch_try_advance();
+            __epoch_collect(rec);
+            rec->in_use.store(false, memory_order_release);
+        }
+    };
+    inline __EpochRecord* __epoch_record() {
+        static thread_local __EpochThread thread_record;
+        return thread_record.rec;
+    }
+
+    inline void __epoch_pin(__EpochRecord* rec) {
+        if (rec->depth++ > 0) return;       // 嵌套的临界区沿用最外层记下的epoch
+        uint64_t epoch = __epoch_domain().epoch.load(memory_order_relaxed);
+        rec->state.store((epoch << 1) | 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);  // 此后读到的共享指针都不早于这次登记
+    }
+    inline void __epoch_unpin(__EpochRecord* rec) {
+        if (--rec->depth == 0) rec->state.store(0, memory_order_release);
+    }
+
+    // 退休ptr：等所有可能引用它的临界区都结束后，由某次epoch_retire()/epoch_reclaim()调用deleter(ptr)
+    inline void epoch_retire(void* ptr, void (*deleter)(void*)) {
+        __EpochRecord* rec = __epoch_record();
+        __epoch_pin(rec);
+        uint64_t epoch = __epoch_domain().epoch.load(memory_order_relaxed);
+        __EpochBag& bag = rec->bags[epoch % 3];
+        if (bag.epoch != epoch) {           // 袋里是epoch-3及更早的垃圾，早已到期
+            if (bag.size > 0) __epoch_free_bag(bag);
+            bag.epoch = epoch;
+        }
+        if (bag.size == bag.capacity) {
+            bag.capacity = bag.capacity ? bag.capacity * 2 : __epoch_scan_interval;
+            bag.items = Allocator<__EpochRetired>::reallocate(bag.items, bag.capacity);
+        }
+        bag.items[bag.size].ptr = ptr;
+        bag.items[bag.size].deleter = deleter;
+        ++bag.size;
+        if (++rec->retired >= __epoch_scan_interval) {
+            rec->retired = 0;
+            __epoch_try_advance();
+            __epoch_collect(rec);
+        }
+        __epoch_unpin(rec);
+    }
+
+    // 尝试推进全局epoch并释放本线程已到期的垃圾，可在线程空闲时调用
+    inline void epoch_reclaim() {
+        __EpochRecord* rec = __epoch_record();
+        if (rec->depth > 0) return;         // 临界区内推进不了
+        __epoch_try_advance();
+        __epoch_collect(rec);
+    }
+};
+
+
+// """临界区守卫EpochGuard"""
+// 构造时进入临界区，析构时离开；其生命期内从共享结构读到的指针都不会被释放
+class EpochGuard {
+private:
+    mystl::__EpochRecord* _rec;
+    EpochGuard(const EpochGuard&);
+    EpochGuard& operator=(const EpochGuard&);
+public:
+    EpochGuard(): _rec(mystl::__epoch_record()) { mystl::__epoch_pin(_rec); }
+    ~EpochGuard() { mystl::__epoch_unpin(_rec); }
+};
+
+
+#endif // __EPOCH__
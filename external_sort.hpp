@@ -0,0 +1,223 @@
+/* external_sort.hpp
+ * 【外部排序】对大于内存的二进制文件排序，文件内容即Type数组的原始字节
+ * (1)分段：每次读入一段到Vector<>，用parallel_sort()排好，称为一个“顺串(run)”；
+ *    所有run首尾相接写在同一个临时文件里，另记下各run的边界
+ * (2)多路归并：每个run配一个带读缓冲的游标，以PriorityQueue<>维护各游标的当前元素，
+ *    每次取出最小者写入写缓冲，再replace()推进该游标；
+ *    run数超过内存可容纳的读缓冲个数（fan-in上限）时，先分组归并成更少、更长的run（写入下一个临时文件），再继续
+ * 内存：分段时run本身 + parallel_sort()的等大辅助空间（多核时）不超过mem_bytes；
+ *       归并时k个读缓冲 + 1个写缓冲不超过mem_bytes；另有run边界数组和PriorityQueue<>的k个指针
+ * 文件：同时打开的只有输入、输出各一个，run再多也不会触及文件描述符的上限；读写全部是大块顺序I/O
+ *
+ * 注意：
+ * 元素按字节原样读写，故只适用于POD类型（int、double、不含指针的struct等）
+ * 每个缓冲至少64KB，mem_bytes小于3个缓冲时按3个缓冲计
+ */
+#ifndef __EXTERNAL_SORT__
+#define __EXTERNAL_SORT__
+#include <cstdio>               // FILE, fopen, fread, fwrite, tmpfile
+#include <climits>              // LLONG_MAX
+#if !defined(_WIN32)
+#include <sys/types.h>          // off_t, fseeko()
+#endif
+#include "alloc.hpp"            // Allocator<>
+#include "vector.hpp"           // Vector<>
+#include "priority_queue.hpp"   // PriorityQueue<>
+#include "sort.hpp"             // parallel_sort()
+using namespace std;
+
+
+namespace mystl {
+    static const size_t __external_default_memory   = 64 << 20;    // 缺省内存上限64MB
+    static const size_t __external_min_buffer       = 64 << 10;    // 每个读/写缓冲至少64KB，保证顺序读写的效率
+
+    // 定位到file的第offset个字节：临时文件常超过2GB，而fseek()的long在Windows和32位平台上只有32位
+    // POSIX用fseeko()（32位平台需以-D_FILE_OFFSET_BITS=64编译，off_t才是64位），Windows用_fseeki64()
+    // off_t装不下offset时返回false，而不是定位到错误的位置
+    inline bool __external_seek(FILE* file, unsigned long long offset) {
+#if defined(_WIN32)
+        return offset <= (unsigned long long)LLONG_MAX && _fseeki64(file, (long long)offset, SEEK_SET) == 0;
+#else
+        off_t pos = (off_t)offset;
+        if (pos < 0 || (unsigned long long)pos != offset) return false;
+        return fseeko(file, pos, SEEK_SET) == 0;
+#endif
+    }
+
+    // run的读游标：buf[pos]即当前元素，读完一缓冲再从文件读下一块
+    // 多个游标共用同一个文件，各自记住下一次从哪里读
+    template <class Type, class ItemCompare>
+    struct __ExternalRun {
+        FILE*               file;
+        Type*               buf;
+        size_t              capacity;   // 缓冲区容量（元素个数）
+        size_t              len;        // 缓冲区中的有效元素个数
+        size_t              pos;        // 当前元素在缓冲区中的位置
+        size_t              next;       // 文件中下一个未读元素的下标
+        size_t              end;        // run在文件中的结束下标
+        size_t              id;         // run的编号，相等元素按编号先后输出
+        bool                failed;     // 读出错（或文件比记录的短）
+        const ItemCompare*  comp;
+        bool refill() {
+            size_t want = end-next < capacity ? end-next : capacity;
+            len = pos = 0;
+            if (want == 0) return false;
+            if (__external_seek(file, (unsigned long long)next * sizeof(Type)))
+                len = fread(buf, sizeof(Type), want, file);
+            next += len;
+            if (len < want) failed = true;  // run的长度是已知的，读不满只能是出错了，不能当作读完
+            return len > 0;
+        }
+        const Type& head() const { return buf[pos]; }
+        bool advance() { return ++pos < len || refill(); }  // 推进到下一个元素，run读完了则返回false
+    };
+
+    // PriorityQueue<>的优先级比较器：当前元素更小（或相等但编号更小）的游标更优先
+    template <class Type, class ItemCompare>
+    struct __ExternalRunSuperior {
+        typedef __ExternalRun<Type, ItemCompare> Run;
+        bool operator()(const Run* a, const Run* b) const {
+            if ((*a->comp)(a->head(), b->head())) return true;
+            if ((*a->comp)(b->head(), a->head())) return false;
+            return a->id < b->id;
+        }
+    };
+
+    // 将file中的run [bounds[0], bounds[1]), ..., [bounds[nruns-1], bounds[nruns])归并后顺序写入out，
+    // 每个读缓冲以及写缓冲都是buf_elems个元素
+    template <class Type, class ItemCompare>
+    bool __external_merge(FILE* file, const size_t* bounds, size_t nruns, FILE* out, size_t buf_elems, const ItemCompare& comp) {
+        typedef __ExternalRun<Type, ItemCompare> Run;
+        Run* cursors = (Run*)malloc(nruns * sizeof(Run));
+        Type* bufs = Allocator<Type>::allocate((nruns+1) * buf_elems);
+        Type* out_buf = bufs + nruns*buf_elems;
+        size_t out_len = 0;
+        PriorityQueue< Run*, __ExternalRunSuperior<Type, ItemCompare> > heap(nruns);
+        for (size_t i=0; i<nruns; ++i) {
+            Run& cur = cursors[i];
+            cur.file = file;        cur.buf = bufs + i*buf_elems;   cur.capacity = buf_elems;
+            cur.next = bounds[i];   cur.end = bounds[i+1];
+            cur.id = i;             cur.failed = false;             cur.comp = &comp;
+            if (cur.refill()) heap.push(&cur);
+        }
+        bool ok = true;
+        while (!heap.empty()) {
+            Run* top = heap.top();
+            out_buf[out_len++] = top->head();
+            if (out_len == buf_elems) {             // 写缓冲满了，整块写出
+                if (fwrite(out_buf, sizeof(Type), out_len, out) != out_len) { ok = false; break; }
+                out_len = 0;
+            }
+            if (top->advance()) heap.replace(top);  // 游标推进后只需一次_shift_down()
+            else heap.pop();
+        }
+        if (ok && out_len > 0)
+            ok = fwrite(out_buf, sizeof(Type), out_len, out) == out_len;
+        if (!ok) cerr << "warning: write error while merging runs!" << endl;
+        for (size_t i=0; i<nruns; ++i)
+            if (cursors[i].failed) {
+                cerr << "warning: read error in temporary run file!" << endl;
+                ok = false;
+                break;
+            }
+        Allocator<Type>::deallocate(bufs);
+        free(cursors);
+        return ok;
+    }
+
+    // 外部排序：将in_path中的Type数组排序后写入out_path，内存占用不超过mem_bytes【不稳定】
+    // 成功返回true；文件打开/读写失败则打印warning并返回false
+    template <class Type, class ItemCompare>
+    bool external_sort(const char* in_path, const char* out_path, size_t mem_bytes, ItemCompare comp) {
+        size_t min_elems = __external_min_buffer / sizeof(Type);
+        if (min_elems == 0) min_elems = 1;
+        if (mem_bytes < 3*min_elems*sizeof(Type)) mem_bytes = 3*min_elems*sizeof(Type);
+        // (1)分段排序，所有run依次写入同一个临时文件，第i个run为[bounds[i], bounds[i+1])
+        FILE* in = fopen(in_path, "rb");
+        if (!in) {
+            cerr << "warning: cannot open " << in_path << "!" << endl;
+            return false;
+        }
+        FILE* runs = tmpfile();                 // tmpfile()创建的文件关闭即删除
+        if (!runs) {
+            cerr << "warning: cannot create temporary run file!" << endl;
+            fclose(in);
+            return false;
+        }
+        Vector<size_t> bounds(1, 0);
+        {
+            // 多核时parallel_sort()还要一块与run等大的辅助空间，故run只用一半内存
+            size_t run_size = (__hardware_threads() > 1 ? mem_bytes/2 : mem_bytes) / sizeof(Type);
+            Vector<Type> run(run_size);
+            size_t len;
+            while ((len = fread(run.begin(), sizeof(Type), run_size, in)) > 0) {
+                parallel_sort(run.begin(), run.begin()+len, comp);
+                if (fwrite(run.begin(), sizeof(Type), len, runs) != len) {
+                    cerr << "warning: cannot write temporary run file!" << endl;
+                    fclose(in);
+                    fclose(runs);
+                    return false;
+                }
+                bounds.push_back(bounds.back() + len);
+            }
+        }
+        bool read_error = ferror(in);           // fread()读不满可能是读完了，也可能是出错了
+        fclose(in);
+        if (read_error || fflush(runs) != 0) {
+            cerr << "warning: " << (read_error ? "cannot read " : "cannot write temporary run file for ") << in_path << "!" << endl;
+            fclose(runs);
+            return false;
+        }
+        // (2)确定fan-in：k个读缓冲 + 1个写缓冲不超过mem_bytes
+        size_t max_fanin = mem_bytes / (min_elems*sizeof(Type)) - 1;
+        // (3)run太多则分组归并，每趟写入一个新的临时文件，直到一趟就能归并完
+        bool ok = true;
+        while (ok && bounds.size()-1 > max_fanin) {
+            size_t nruns = bounds.size() - 1;
+            size_t buf_elems = mem_bytes / ((max_fanin+1) * sizeof(Type));
+            FILE* next = tmpfile();
+            if (!next) {
+                cerr << "warning: cannot create temporary run file!" << endl;
+                ok = false;
+                break;
+            }
+            Vector<size_t> next_bounds(1, 0);
+            for (size_t i=0; ok && i<nruns; i+=max_fanin) {
+                size_t k = nruns-i < max_fanin ? nruns-i : max_fanin;
+                ok = __external_merge<Type>(runs, &bounds[i], k, next, buf_elems, comp);
+                next_bounds.push_back(bounds[i+k]);     // 合并后的run恰好占据原来k个run的位置
+            }
+            if (ok && fflush(next) != 0) {
+                cerr << "warning: cannot write temporary run file!" << endl;
+                ok = false;
+            }
+            fclose(runs);
+            runs = next;
+            bounds.swap(next_bounds);
+        }
+        // (4)最后一趟归并，直接写入out_path
+        FILE* out = ok ? fopen(out_path, "wb") : nullptr;
+        if (out) {
+            size_t nruns = bounds.size() - 1;
+            size_t buf_elems = mem_bytes / ((nruns+1) * sizeof(Type));     // run越少，每个缓冲越大
+            ok = __external_merge<Type>(runs, bounds.begin(), nruns, out, buf_elems, comp);
+            if (fclose(out) != 0 && ok) {
+                cerr << "warning: cannot write " << out_path << "!" << endl;
+                ok = false;
+            }
+        }
+        else if (ok) {
+            cerr << "warning: cannot open " << out_path << "!" << endl;
+            ok = false;
+        }
+        if (!ok) cerr << "warning: external_sort(" << in_path << ") failed!" << endl;
+        fclose(runs);
+        return ok;
+    }
+    template <class Type>
+    bool external_sort(const char* in_path, const char* out_path, size_t mem_bytes = __external_default_memory)
+        { return external_sort<Type>(in_path, out_path, mem_bytes, Less<Type>()); }
+};
+
+
+#endif // __EXTERNAL_SORT__
@@ -0,0 +1,98 @@
+/* filtered_map.hpp
+ * 【带过滤器的映射】在映射前面挡一层BloomFilter<>/CuckooFilter<>：过滤器判“一定不存在”的键直接返回，不碰映射本身
+ * 适用于绝大多数查找都不命中的场景（如黑名单、去重、缓存穿透）；映射越大、越慢（cache miss多、在磁盘上），收益越大
+ *
+ * Map可以是HashMap<> FlatHashMap<> FrozenHashMap<> 等：要求有find()/end()/contains()/size()，且遍历得到的元素有key成员
+ * （insert()/erase()只在用到时才要求）；Filter须有insert()/might_contain()/erase()/size()/capacity()/swap()
+ *
+ * 注意：
+ * (1)只能通过本类增删，直接改map()会使过滤器漏判
+ * (2)过滤器插入次数达到其容量（或CuckooFilter<>放不下）时，按两倍容量遍历映射重建；布隆过滤器里已删除键的残留位也随之清除
+ */
+#ifndef __FILTERED_MAP__
+#define __FILTERED_MAP__
+#include <iostream>
+#include "bloom_filter.hpp"
+#include "cuckoo_filter.hpp"
+using namespace std;
+
+
+// """带过滤器的映射"""
+template <class Map, class Filter>
+class FilteredMap {
+
+public:     // 【类型定义】
+    typedef typename Filter::key_type   key_type;
+    typedef typename Map::iterator      iterator;
+    typedef size_t                      size_type;
+
+private:    // 【成员变量】
+    Map     _map;
+    Filter  _filter;
+
+private:
+    // 以至少capacity的容量重建过滤器【CuckooFilter<>偶尔放不下时再翻倍】
+    void _rebuild(size_type capacity) {
+        for (bool ok = false; !ok; capacity *= 2) {
+            Filter filter(capacity);
+            ok = true;
+            for (const auto& item : _map)
+                if (!filter.insert(item.key)) { ok = false;  break; }
+            if (ok) _filter.swap(filter);
+        }
+    }
+    void _filter_insert(const key_type& key) {
+        if (_filter.size() >= _filter.capacity() || !_filter.insert(key)) {
+            size_type capacity = _map.size() > _filter.capacity() ? _map.size() : _filter.capacity();
+            _rebuild(2 * capacity);     // 映射里已有key，重建时一并放入
+        }
+    }
+
+public:     // 【构造函数】
+    // 过滤器预留capacity个键，超出时自动扩容
+    explicit FilteredMap(size_type capacity = 1024): _filter(capacity) {}
+    // 给现成的映射（如构建好的FrozenHashMap<>）加上过滤器
+    explicit FilteredMap(const Map& map): _map(map), _filter(1) { _rebuild(map.size() > 1024 ? map.size() : 1024); }
+
+public:     // 【Basic Accessor】
+    size_type size()        const { return _map.size(); }
+    bool empty()            const { return _map.size() == 0; }
+    iterator begin()        const { return _map.begin(); }
+    iterator end()          const { return _map.end(); }
+    const Map& map()        const { return _map; }
+    const Filter& filter()  const { return _filter; }
+
+public:     // 【增、改、查】
+    // 插入键值对，键已存在则覆盖其值
+    template <class Value>
+    void insert(const key_type& key, const Value& value) {
+        size_type old_size = _map.size();
+        _map.insert(key, value);
+        if (_map.size() != old_size) _filter_insert(key);
+    }
+    iterator find(const key_type& key) const
+        { return _filter.might_contain(key) ? _map.find(key) : _map.end(); }
+    bool contains(const key_type& key)      const { return _filter.might_contain(key) && _map.contains(key); }
+    size_type count(const key_type& key)    const { return contains(key) ? 1 : 0; }
+
+public:     // 【删】
+    size_type erase(const key_type& key) {
+        if (!_filter.might_contain(key)) return 0;
+        size_type erased = _map.erase(key);
+        if (erased) _filter.erase(key);
+        return erased;
+    }
+    void clear() {
+        _map.clear();
+        _filter.clear();
+    }
+};
+
+// cout << filtered_map;
+template <class Map, class Filter>
+ostream& operator<<(ostream& out, const FilteredMap<Map, Filter>& filtered_map) {
+    return out << filtered_map.map();
+}
+
+
+#endif // __FILTERED_MAP__
@@ -0,0 +1,408 @@
+/* flat_hash_map.hpp
+ * 【开放寻址哈希映射】键值对直接存放在一个连续数组里，没有节点、没有链表指针
+ * 参考google abseil的SwissTable(flat_hash_map)
+ *
+ * 结构：
+ * (1)每个槽位配一个控制字节ctrl：空槽为__ctrl_empty(0x80)，占用则为哈希值的低7位H2(0~127)
+ * (2)哈希值的其余高位H1决定起始槽位，线性探测；每次取出16个控制字节（一组）与H2做SSE2的16路并行比较，
+ *    只有控制字节相同的槽位才真正比较键，绝大多数情况下一次比较即命中或确定不存在
+ * (3)ctrl数组末尾额外复制开头的15个字节，任一槽位起的16字节都可一次读出，不必处理回绕
+ * (4)删除不留墓碑(tombstone)：把后面“本可以放得更靠前”的元素依次前移补洞（backward shift），
+ *    探测序列上永远没有墓碑，查找在遇到第一个空槽时即可停止
+ * (5)容量总是2的幂，负载因子上限7/8，槽位号即 H1 & (容量-1)
+ *
+ * 注意：
+ * 插入（可能扩容）与删除（前移补洞）都会挪动元素，之前的迭代器、元素指针全部失效
+ */
+#ifndef __FLAT_HASH_MAP__
+#define __FLAT_HASH_MAP__
+#include <initializer_list>
+#include <iostream>
+#include <cstring>      // memset()
+#include <cstdint>      // uint64_t
+#include <new>          // placement new
+#include <utility>      // move()
+#include "alloc.hpp"
+#include "utils.hpp"
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>  // SSE2
+#define __FLAT_HASH_MAP_SSE2__
+#endif
+using namespace std;
+
+
+// """控制字节组"""
+// 16个控制字节的并行匹配：返回16位掩码，第i位为1即第i个控制字节满足条件
+static const signed char __ctrl_empty = (signed char)0x80;
+static const size_t      __group_width = 16;
+struct __CtrlGroup {
+#ifdef __FLAT_HASH_MAP_SSE2__
+    __m128i ctrl;
+    explicit __CtrlGroup(const signed char* pos): ctrl(_mm_loadu_si128((const __m128i*)pos)) {}
+    unsigned match(signed char h2) const
+        { return (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(h2))); }
+    unsigned match_empty() const
+        { return (unsigned)_mm_movemask_epi8(ctrl); }   // 只有空槽的最高位为1
+#else   // 无SSE2时逐字节比较
+    const signed char* ctrl;
+    explicit __CtrlGroup(const signed char* pos): ctrl(pos) {}
+    unsigned match(signed char h2) const {
+        unsigned mask = 0;
+        for (size_t i=0; i<__group_width; ++i) mask |= (unsigned)(ctrl[i] == h2) << i;
+        return mask;
+    }
+    unsigned match_empty() const { return match(__ctrl_empty); }
+#endif
+};
+// 掩码中最低位1的位置
+inline size_t __lowest_bit(unsigned mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (size_t)__builtin_ctz(mask);
+#else
+    size_t idx = 0;
+    while (!(mask & 1)) { mask >>= 1;  ++idx; }
+    return idx;
+#endif
+}
+
+
+// 槽位【it->key，it->value】
+template <class Key, class Value>
+struct __FlatHashMapSlot {
+    Key     key;
+    Value   value;
+};
+
+
+// 迭代器
+template <class FlatMap>
+struct __FlatHashMapIterator {
+    // 类型定义
+    typedef ForwardIteratorTag                  iterator_category;  // 前向迭代器
+    typedef typename FlatMap::slot_type         Slot;
+    typedef Slot                                value_type;
+    typedef Slot*                               pointer;
+    typedef Slot&                               reference;
+    typedef size_t                              size_type;
+    typedef ptrdiff_t                           difference_type;
+    typedef __FlatHashMapIterator<FlatMap>      iterator;
+    // 成员变量
+    const FlatMap*  map;
+    size_type       idx;        // 槽位号，idx == capacity()即end()
+    // 构造函数
+    __FlatHashMapIterator(): map(nullptr), idx(0) {}
+    __FlatHashMapIterator(const FlatMap* fmap, size_type index): map(fmap), idx(index) {}
+    // *self, ->self, self==other, self!=other
+    Slot& operator*()  const { return map->_slots[idx]; }
+    Slot* operator->() const { return map->_slots + idx; }
+    bool operator==(const iterator& other) const { return idx == other.idx; }
+    bool operator!=(const iterator& other) const { return idx != other.idx; }
+    // ++self, self++
+    iterator& operator++()
+        { idx = map->_next_full(idx+1);  return *this; }
+    iterator operator++(int)
+        { iterator tmp(*this);  idx = map->_next_full(idx+1);  return tmp; }
+};
+
+
+// """开放寻址哈希映射[abseil flat_hash_map<>]"""
+template <class Key,
+          class Value,
+          class KeyHasher   = HashCode<Key>,
+          class KeyCompare  = Compare<Key>,
+          class Alloc       = FirstAlloc>
+class FlatHashMap {
+
+public:     // 【类型定义】
+    typedef Pair<Key, Value>    value_type;
+    typedef size_t              size_type;
+    typedef ptrdiff_t           difference_type;
+    typedef __FlatHashMapSlot<Key, Value>   slot_type;
+    typedef FlatHashMap<Key, Value, KeyHasher, KeyCompare, Alloc>   self;
+    typedef __FlatHashMapIterator<self>     iterator;
+    typedef Allocator<slot_type, Alloc>     slot_allocator;
+    typedef Allocator<signed char, Alloc>   ctrl_allocator;
+    friend struct __FlatHashMapIterator<self>;
+    static const size_type min_capacity = __group_width;
+
+private:    // 【成员变量】
+    KeyCompare      _compare;
+    KeyHasher       _hasher;
+    signed char*    _ctrl;      // _capacity + __group_width-1 个控制字节（末尾是开头的拷贝）
+    slot_type*      _slots;     // _capacity 个槽位
+    size_type       _capacity;  // 0或2的幂
+    size_type       _size;
+
+private:    // 【哈希】
+    // 自定义的HashCode<>未必混合充分（如恒等映射），再混合一次使高低位都均匀（murmur3的fmix64）
+    static size_type _mix(size_type hash_code) {
+        uint64_t h = (uint64_t)hash_code;
+        h ^= h >> 33;  h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;  h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return (size_type)h;
+    }
+    template <class K>
+    size_type _hash(const K& key) const { return _mix(_hasher(key)); }
+    static size_type   _h1(size_type hash) { return hash >> 7; }
+    static signed char _h2(size_type hash) { return (signed char)(hash & 0x7F); }
+
+private:    // 【控制字节】
+    void _set_ctrl(size_type idx, signed char h) {
+        _ctrl[idx] = h;
+        if (idx < __group_width-1) _ctrl[_capacity + idx] = h;     // 维护末尾的拷贝
+    }
+    bool _is_full(size_type idx) const { return _ctrl[idx] >= 0; }
+    size_type _next_full(size_type idx) const {
+        while (idx < _capacity && !_is_full(idx)) ++idx;
+        return idx;
+    }
+
+private:    // 【扩容】
+    void _allocate(size_type capacity) {
+        _capacity = capacity;
+        _slots = slot_allocator::allocate(capacity);
+        _ctrl = ctrl_allocator::allocate(capacity + __group_width-1);
+        memset(_ctrl, __ctrl_empty, capacity + __group_width-1);
+    }
+    // 把所有元素移动到容量为capacity的新数组
+    void _rehash(size_type capacity) {
+        signed char* old_ctrl = _ctrl;
+        slot_type* old_slots = _slots;
+        size_type old_capacity = _capacity;
+        _allocate(capacity);
+        for (size_type i=0; i<old_capacity; ++i) {
+            if (old_ctrl[i] < 0) continue;
+            size_type hash = _hash(old_slots[i].key);
+            size_type idx = _find_empty(hash);
+            new (_slots+idx) slot_type(std::move(old_slots[i]));
+            _set_ctrl(idx, _h2(hash));
+            old_slots[i].~slot_type();
+        }
+        slot_allocator::deallocate(old_slots);
+        ctrl_allocator::deallocate(old_ctrl);
+    }
+    // 能容纳n个元素（负载因子不超过7/8）的最小容量
+    static size_type _capacity_for(size_type n) {
+        size_type capacity = min_capacity;
+        while (capacity - capacity/8 < n) capacity *= 2;
+        return capacity;
+    }
+
+private:    // 【探测】
+    // 查找键为key的槽位，不存在则返回_capacity
+    // K通常即Key，KeyHasher/KeyCompare透明时也可以是const char*、StringView等
+    template <class K>
+    size_type _find(const K& key, size_type hash) const {
+        if (_capacity == 0) return 0;
+        size_type mask = _capacity - 1;
+        signed char h2 = _h2(hash);
+        for (size_type pos = _h1(hash) & mask; ; pos = (pos + __group_width) & mask) {
+            __CtrlGroup group(_ctrl + pos);
+            for (unsigned m = group.match(h2); m; m &= m-1) {
+                size_type idx = (pos + __lowest_bit(m)) & mask;
+                if (_compare(_slots[idx].key, key) == 0) return idx;
+            }
+            if (group.match_empty()) return _capacity;  // 探测序列上没有墓碑，遇到空槽即可断定不存在
+        }
+    }
+    // 从hash的起始槽位起，第一个空槽
+    size_type _find_empty(size_type hash) const {
+        size_type mask = _capacity - 1;
+        for (size_type pos = _h1(hash) & mask; ; pos = (pos + __group_width) & mask) {
+            unsigned m = __CtrlGroup(_ctrl + pos).match_empty();
+            if (m) return (pos + __lowest_bit(m)) & mask;
+        }
+    }
+    // 返回键为key的槽位，不存在则插入一个（值初始化的）新元素
+    size_type _insert_slot(const Key& key) { return _insert_slot(key, _hash(key)); }
+    size_type _insert_slot(const Key& key, size_type hash) {
+        size_type idx = _find(key, hash);
+        if (idx < _capacity) return idx;
+        if (_size + 1 > _capacity - _capacity/8)    // 负载因子上限7/8
+            _rehash(_capacity ? _capacity*2 : min_capacity);
+        idx = _find_empty(hash);
+        new (_slots+idx) slot_type();
+        _slots[idx].key = key;
+        _set_ctrl(idx, _h2(hash));
+        ++_size;
+        return idx;
+    }
+
+public:     // 【构造/析构函数】
+    FlatHashMap():
+        _ctrl(nullptr), _slots(nullptr), _capacity(0), _size(0) {}
+    FlatHashMap(initializer_list<value_type> init_list):
+        _ctrl(nullptr), _slots(nullptr), _capacity(0), _size(0) {
+        reserve(init_list.size());
+        for (const auto& item : init_list)
+            insert(item.first, item.second);
+    }
+    FlatHashMap(const FlatHashMap& other):
+        _ctrl(nullptr), _slots(nullptr), _capacity(0), _size(0) {
+        reserve(other.size());
+        for (const slot_type& slot : other)
+            insert(slot.key, slot.value);
+    }
+    FlatHashMap& operator=(const FlatHashMap& other) {
+        if (this != &other) {
+            FlatHashMap copy(other);
+            this->swap(copy);
+        }
+        return *this;
+    }
+    ~FlatHashMap() {
+        clear();
+        slot_allocator::deallocate(_slots);
+        ctrl_allocator::deallocate(_ctrl);
+    }
+    void swap(FlatHashMap& other) {
+        std::swap(_compare, other._compare);    std::swap(_hasher, other._hasher);
+        std::swap(_ctrl, other._ctrl);          std::swap(_slots, other._slots);
+        std::swap(_capacity, other._capacity);  std::swap(_size, other._size);
+    }
+
+public:     // 【Basic Accessor】
+    size_type size()     const { return _size; }
+    size_type capacity() const { return _capacity; }
+    bool empty()         const { return _size == 0; }
+    iterator begin()     const { return iterator(this, _capacity ? _next_full(0) : 0); }
+    iterator end()       const { return iterator(this, _capacity); }
+    // 预留至少能容纳n个元素的空间，之后插入n个元素不会再扩容
+    void reserve(size_type n) {
+        size_type capacity = _capacity_for(n);
+        if (capacity > _capacity) _rehash(capacity);
+    }
+
+public:     // 【增、改、查】
+    // 插入键值对，键已存在则覆盖其值
+    // 【先取得槽位号再访问_slots：_insert_slot()可能扩容，_slots[_insert_slot(key)]的求值顺序是未指定的】
+    void insert(const Key& key, const Value& value) {
+        size_type idx = _insert_slot(key);
+        _slots[idx].value = value;
+    }
+    // 键不存在时插入Value()
+    Value& operator[](const Key& key) {
+        size_type idx = _insert_slot(key);
+        return _slots[idx].value;
+    }
+    const Value& operator[](const Key& key) const {
+        size_type idx = _find(key, _hash(key));
+        if (idx >= _capacity) {
+            cerr << "warning: " << "key not found in FlatHashMap(at " << this << ")!" << endl;
+            static const Value default_value = Value();
+            return default_value;
+        }
+        return _slots[idx].value;
+    }
+    iterator find(const Key& key)   const { return iterator(this, _find(key, _hash(key))); }
+    bool contains(const Key& key)   const { return _find(key, _hash(key)) < _capacity; }
+    size_type count(const Key& key) const { return contains(key) ? 1 : 0; }
+    // 透明查找：KeyHasher与KeyCompare都声明了is_transparent时，可直接以const char*/StringView等查找，不构造临时Key
+    template <class K, class = typename __TransparentKey<KeyHasher, KeyCompare, K>::type>
+    iterator find(const K& key)     const { return iterator(this, _find(key, _hash(key))); }
+    template <class K, class = typename __TransparentKey<KeyHasher, KeyCompare, K>::type>
+    bool contains(const K& key)     const { return _find(key, _hash(key)) < _capacity; }
+    template <class K, class = typename __TransparentKey<KeyHasher, KeyCompare, K>::type>
+    size_type count(const K& key)   const { return contains(key) ? 1 : 0; }
+
+private:    // 【批量查找/插入】
+    // 随机查找大表时每个键都要等控制字节组与槽位的cache miss，逐个查找时这些等待是串行的
+    // 改为两级软件流水线：第i步解析键i-D（其控制字节组与槽位已预取），再计算键i的哈希值并发出预取
+    static const size_type __batch_distance = 8;
+    void _prefetch_hashed(size_type hash) const {
+        if (_capacity == 0) return;
+        size_type pos = _h1(hash) & (_capacity-1);
+        __prefetch(_ctrl + pos);
+        __prefetch(_slots + pos);
+    }
+    // 对keys[0, n)逐个调用visit(i, idx)，idx为键keys[i]的槽位，不存在则为_capacity
+    template <class K, class Visitor>
+    void _find_batch(const K* keys, size_type n, Visitor visit) const {
+        const size_type D = __batch_distance;
+        size_type hashes[D];                        // 环形缓冲：已算出哈希值、尚未解析的键
+        for (size_type i=0; i < n + D; ++i) {
+            if (i >= D && i-D < n)                  // 先解析再覆盖：键i与键i-D共用同一格
+                visit(i-D, _find(keys[i-D], hashes[(i-D) % D]));
+            if (i < n) {
+                hashes[i % D] = _hash(keys[i]);
+                _prefetch_hashed(hashes[i % D]);
+            }
+        }
+    }
+
+public:     // 【批量查找/插入】以软件流水线预取，让多个cache miss重叠【一批上千个键时效果最好】
+    // out[i]即键keys[i]对应值的指针，不存在则为nullptr；返回找到的个数
+    // 【之后的插入/删除会挪动元素，out中的指针随之失效】
+    size_type find_batch(const Key* keys, size_type n, Value** out) const {
+        size_type found = 0;
+        _find_batch(keys, n, [&](size_type i, size_type idx) {
+            out[i] = idx < _capacity ? &_slots[idx].value : nullptr;
+            found += idx < _capacity;
+        });
+        return found;
+    }
+    template <class K, class = typename __TransparentKey<KeyHasher, KeyCompare, K>::type>
+    size_type find_batch(const K* keys, size_type n, Value** out) const {
+        size_type found = 0;
+        _find_batch(keys, n, [&](size_type i, size_type idx) {
+            out[i] = idx < _capacity ? &_slots[idx].value : nullptr;
+            found += idx < _capacity;
+        });
+        return found;
+    }
+    // 依次插入(keys[i], values[i])，键已存在则覆盖其值；先reserve()，批内不会中途扩容使预取作废
+    void insert_batch(const Key* keys, const Value* values, size_type n) {
+        reserve(_size + n);
+        const size_type D = __batch_distance;
+        size_type hashes[D];
+        for (size_type i=0; i < n + D; ++i) {
+            if (i >= D && i-D < n) {
+                size_type idx = _insert_slot(keys[i-D], hashes[(i-D) % D]);
+                _slots[idx].value = values[i-D];
+            }
+            if (i < n) {
+                hashes[i % D] = _hash(keys[i]);
+                _prefetch_hashed(hashes[i % D]);
+            }
+        }
+    }
+
+public:     // 【删】
+    // 删除键为key的元素，返回删除的个数（0或1）
+    // backward shift：洞后面的元素若起始槽位不在(洞, 该元素]之间，说明它本可以放在洞里，前移补洞，洞随之后移
+    size_type erase(const Key& key) {
+        size_type hole = _find(key, _hash(key));
+        if (hole >= _capacity) return 0;
+        size_type mask = _capacity - 1;
+        _slots[hole].~slot_type();
+        for (size_type cur = (hole+1) & mask; _is_full(cur); cur = (cur+1) & mask) {
+            size_type home = _h1(_hash(_slots[cur].key)) & mask;
+            if (((cur - home) & mask) < ((cur - hole) & mask)) continue;    // 起始槽位在(洞, cur]之间，不能前移
+            new (_slots+hole) slot_type(std::move(_slots[cur]));
+            _slots[cur].~slot_type();
+            _set_ctrl(hole, _ctrl[cur]);
+            hole = cur;
+        }
+        _set_ctrl(hole, __ctrl_empty);
+        --_size;
+        return 1;
+    }
+    void clear() {
+        for (size_type i=0; i<_capacity; ++i)
+            if (_is_full(i)) _slots[i].~slot_type();
+        if (_capacity) memset(_ctrl, __ctrl_empty, _capacity + __group_width-1);
+        _size = 0;
+    }
+};
+
+// cout << flat_hash_map;
+template <class Key, class Value, class KeyHasher, class KeyCompare, class Alloc>
+ostream& operator<<(ostream& out, const FlatHashMap<Key, Value, KeyHasher, KeyCompare, Alloc>& flat_map) {
+    out << "{ ";
+    for (const auto& slot : flat_map) out << slot.key << ": " << slot.value << ", ";
+    return out << "}";
+}
+
+
+#endif // __FLAT_HASH_MAP__
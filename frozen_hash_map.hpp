@@ -0,0 +1,447 @@
+/* frozen_hash_map.hpp
+ * 【只读哈希映射】一次性构建、之后只查不改的映射（如启动时加载的配置表、字典），以最小完美哈希寻址
+ * 参考PTHash(Pibiri & Trani, 2021)以及CHD的“分桶+位移”思想
+ *
+ * 结构：
+ * (1)n个键值对存放在恰好n个槽位的连续数组里，没有空槽、没有节点指针
+ * (2)键按哈希值分到约n/3个桶，每个桶存一个32位的“位移(pilot)”，键的槽位即 position(hash, pilot) ∈ [0, n)
+ * (3)构建时按桶从大到小逐个试pilot = 0, 1, 2, ...，直到桶内的键全部落在尚未占用的、互不相同的槽位
+ * (4)查找：算哈希值 → 读所在桶的pilot → 算出唯一的槽位 → 比较一次键，命中或不存在都只探测这一个槽位
+ *    每个键只额外花约1.3字节（pilot）
+ *
+ * 序列化：
+ * 整张表本身就放在一块连续内存里（表头 + pilot数组 + 槽位数组），即可直接写入文件的二进制块(blob)；
+ * 键、值都可平凡拷贝时，可save()到文件，之后load()读回，或把文件mmap()后attach()直接使用，无需任何解析/重建
+ * 【blob按本机字节序与类型布局保存，只在同一平台、同一键值类型之间通用】
+ *
+ * 注意：
+ * 不同的键若HashCode<>完全相同，任何pilot都分不开它们，构建失败（HashCode<>是恒等映射的整数键不会出现）
+ */
+#ifndef __FROZEN_HASH_MAP__
+#define __FROZEN_HASH_MAP__
+#include <iostream>
+#include <cstdio>       // FILE, fopen, fread, fwrite
+#include <cstring>      // memcpy(), memset()
+#include <cstdint>      // uint32_t, uint64_t, uintptr_t
+#include <new>          // placement new
+#include <type_traits>  // is_trivially_copyable<>
+#include "alloc.hpp"
+#include "utils.hpp"
+#include "vector.hpp"
+#include "hash_map.hpp"
+using namespace std;
+
+
+namespace mystl {
+    static const uint64_t __frozen_magic = 0x4d484e455a4f5246ULL;  // "FROZENHM"
+    static const size_t   __frozen_bucket_keys = 3;     // 平均每桶的键数【越大pilot数组越小，但构建越慢】
+    static const size_t   __frozen_align = 64;          // blob内各段按缓存行对齐
+    static const size_t   __frozen_max_attempts = 8;    // pilot溢出32位时换种子重试的次数
+
+    // 64位整数的高64位乘积：把均匀的x映射到[0, n)，比取模快得多（Lemire的fastrange）
+    // 【不依赖__int128时也算出完全相同的结果，blob换个编译器读也能找到同一槽位】
+    inline uint64_t __fast_range(uint64_t x, uint64_t n) {
+#ifdef __SIZEOF_INT128__
+        return (uint64_t)(((unsigned __int128)x * n) >> 64);
+#else
+        uint64_t x_lo = x & 0xffffffffULL, x_hi = x >> 32;
+        uint64_t n_lo = n & 0xffffffffULL, n_hi = n >> 32;
+        uint64_t lo_lo = x_lo * n_lo, hi_lo = x_hi * n_lo, lo_hi = x_lo * n_hi;
+        uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xffffffffULL) + lo_hi;
+        return (hi_lo >> 32) + (cross >> 32) + x_hi * n_hi;
+#endif
+    }
+    // murmur3的fmix64，是双射：不同的输入一定得到不同的输出
+    inline uint64_t __frozen_mix(uint64_t h) {
+        h ^= h >> 33;  h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;  h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+    inline size_t __frozen_round_up(size_t nbytes) {
+        return (nbytes + __frozen_align - 1) / __frozen_align * __frozen_align;
+    }
+
+    // blob的表头，其后依次是pilot数组、槽位数组（各自从64字节对齐处开始）
+    struct __FrozenHashMapHeader {
+        uint64_t    magic;
+        uint64_t    slot_size;      // sizeof(槽位)，加载时校验键值类型是否一致
+        uint64_t    size;           // 键值对数，即槽位数
+        uint64_t    n_buckets;
+        uint64_t    seed;
+    };
+};
+
+
+// 槽位【it->key，it->value】
+template <class Key, class Value>
+struct __FrozenHashMapSlot {
+    Key     key;
+    Value   value;
+};
+
+
+// """只读哈希映射"""
+template <class Key,
+          class Value,
+          class KeyHasher   = HashCode<Key>,
+          class KeyCompare  = Compare<Key> >
+class FrozenHashMap {
+
+public:     // 【类型定义】
+    typedef Pair<Key, Value>    value_type;
+    typedef size_t              size_type;
+    typedef __FrozenHashMapSlot<Key, Value>     slot_type;
+    typedef const slot_type*                    iterator;
+    typedef mystl::__FrozenHashMapHeader        header_type;
+
+private:    // 【成员变量】
+    KeyHasher           _hasher;
+    KeyCompare          _compare;
+    char*               _blob;      // 表头 + pilot数组 + 槽位数组
+    bool                _owned;     // _blob是否由本对象分配（attach()的则不是）
+    const uint32_t*     _pilots;
+    slot_type*          _slots;
+    size_type           _size;
+    size_type           _n_buckets;
+    uint64_t            _seed;
+
+private:    // 【哈希与寻址】
+    template <class K>
+    uint64_t _hash(const K& key) const { return mystl::__frozen_mix((uint64_t)_hasher(key) ^ _seed); }
+    uint64_t _bucket(uint64_t h) const { return mystl::__fast_range(h, _n_buckets); }
+    static uint64_t _position(uint64_t h, uint64_t pilot, uint64_t n)
+        { return mystl::__fast_range(mystl::__frozen_mix(h + pilot * 0x9E3779B97F4A7C15ULL), n); }
+    // 唯一可能存放key的槽位，键不同则返回nullptr
+    template <class K>
+    const slot_type* _find_slot(const K& key) const {
+        if (_size == 0) return nullptr;
+        uint64_t h = _hash(key);
+        const slot_type* slot = _slots + _position(h, _pilots[_bucket(h)], _size);
+        return _compare(slot->key, key) == 0 ? slot : nullptr;
+    }
+
+private:    // 【blob布局】
+    static size_type _slots_offset(size_type n_buckets)
+        { return mystl::__frozen_round_up(sizeof(header_type)) + mystl::__frozen_round_up(n_buckets * sizeof(uint32_t)); }
+    static size_type _blob_size(size_type size, size_type n_buckets)
+        { return _slots_offset(n_buckets) + size * sizeof(slot_type); }
+    // 按blob里的表头设置各成员（不校验）
+    void _bind(char* blob, bool owned) {
+        const header_type* header = (const header_type*)blob;
+        _blob       = blob;
+        _owned      = owned;
+        _size       = (size_type)header->size;
+        _n_buckets  = (size_type)header->n_buckets;
+        _seed       = header->seed;
+        _pilots     = (const uint32_t*)(blob + mystl::__frozen_round_up(sizeof(header_type)));
+        _slots      = (slot_type*)(blob + _slots_offset(_n_buckets));
+    }
+    // 校验长为len的blob是否是本类型的表
+    static bool _check_blob(const char* blob, size_type len) {
+        if (len < sizeof(header_type)) return false;
+        const header_type* header = (const header_type*)blob;
+        return header->magic == mystl::__frozen_magic && header->slot_size == sizeof(slot_type) &&
+               header->n_buckets > 0 && len == _blob_size((size_type)header->size, (size_type)header->n_buckets) &&
+               (uintptr_t)(blob + _slots_offset((size_type)header->n_buckets)) % alignof(slot_type) == 0;
+    }
+    void _release() {
+        if (_owned) {
+            for (size_type i=0; i<_size; ++i) _slots[i].~slot_type();
+            FirstAlloc::deallocate(_blob);
+        }
+        _blob = nullptr;  _owned = false;
+        _pilots = nullptr;  _slots = nullptr;
+        _size = 0;  _n_buckets = 0;  _seed = 0;
+    }
+
+private:    // 【构建】
+    enum { __build_ok, __build_retry, __build_fail };
+    // 以种子seed为键keys[0, n)分桶、求pilot；成功则slot_src[槽位] = 放在该槽位的键的下标
+    // 同一个键出现多次时只保留下标最大的（即后出现的覆盖先出现的），被覆盖的在dead中标记并计入n_dead
+    int _place(const Key* const* keys, size_type n, size_type n_buckets, uint64_t seed,
+               size_type* slot_src, bool* dead, size_type& n_dead) {
+        int result = __build_ok;
+        uint64_t* hashes     = Allocator<uint64_t>::allocate(n + 1);
+        size_type* starts    = (size_type*)FirstAlloc::clallocate(n_buckets + 1, sizeof(size_type));
+        size_type* members   = Allocator<size_type>::allocate(n + 1);              // 按桶排好的键下标
+        size_type* order     = Allocator<size_type>::allocate(n_buckets);          // 按大小降序排好的桶号
+        uint32_t* pilots     = (uint32_t*)(_blob + mystl::__frozen_round_up(sizeof(header_type)));
+        uint64_t* taken      = (uint64_t*)FirstAlloc::clallocate(n/64 + 1, sizeof(uint64_t));
+        // 计数排序：按桶号排键
+        for (size_type i=0; i<n; ++i) {
+            hashes[i] = mystl::__frozen_mix((uint64_t)_hasher(*keys[i]) ^ seed);
+            ++starts[mystl::__fast_range(hashes[i], n_buckets) + 1];
+        }
+        size_type max_size = 0;
+        for (size_type b=0; b<n_buckets; ++b) {
+            if (starts[b+1] > max_size) max_size = starts[b+1];
+            starts[b+1] += starts[b];
+        }
+        size_type* fill = Allocator<size_type>::allocate(n_buckets);
+        memcpy(fill, starts, n_buckets * sizeof(size_type));
+        for (size_type i=0; i<n; ++i) members[fill[mystl::__fast_range(hashes[i], n_buckets)]++] = i;
+        // 计数排序：按桶的大小降序排桶（大桶约束多，趁空槽多时先放）
+        size_type* by_size = (size_type*)FirstAlloc::clallocate(max_size + 2, sizeof(size_type));
+        for (size_type b=0; b<n_buckets; ++b) ++by_size[max_size - (starts[b+1]-starts[b]) + 1];
+        for (size_type s=0; s<=max_size; ++s) by_size[s+1] += by_size[s];
+        for (size_type b=0; b<n_buckets; ++b) order[by_size[max_size - (starts[b+1]-starts[b])]++] = b;
+        FirstAlloc::deallocate(by_size);
+        FirstAlloc::deallocate(fill);
+        // 桶内哈希值相同的键：同一个键重复出现则去掉先出现的，否则分不开
+        for (size_type b=0; b<n_buckets && result == __build_ok; ++b)
+            for (size_type i=starts[b]; i<starts[b+1] && result == __build_ok; ++i)
+                for (size_type j=i+1; j<starts[b+1]; ++j) {
+                    size_type u = members[i], v = members[j];
+                    if (hashes[u] != hashes[v] || dead[u] || dead[v]) continue;
+                    if (_compare(*keys[u], *keys[v]) != 0) {
+                        cerr << "warning: " << "distinct keys with equal hash codes, cannot build FrozenHashMap(at " << this << ")!" << endl;
+                        result = __build_fail;
+                        break;
+                    }
+                    dead[u < v ? u : v] = true;
+                    ++n_dead;
+                }
+        if (n_dead > 0 && result == __build_ok) result = __build_retry;    // 去重后按实际个数重建
+        // 逐桶试pilot
+        size_type* positions = Allocator<size_type>::allocate(max_size + 1);
+        for (size_type k=0; k<n_buckets && result == __build_ok; ++k) {
+            size_type b = order[k];
+            pilots[b] = 0;
+            for (uint64_t pilot=0; starts[b] < starts[b+1]; ++pilot) {
+                if (pilot > 0xffffffffULL) { result = __build_retry;  break; }
+                size_type cnt = 0;
+                for (size_type i=starts[b]; i<starts[b+1]; ++i, ++cnt) {
+                    size_type pos = (size_type)_position(hashes[members[i]], pilot, n);
+                    if (taken[pos/64] >> (pos%64) & 1) break;
+                    taken[pos/64] |= 1ULL << (pos%64);      // 先占上，桶内后面的键撞上它也算冲突
+                    positions[cnt] = pos;
+                }
+                if (starts[b] + cnt == starts[b+1]) {
+                    pilots[b] = (uint32_t)pilot;
+                    for (size_type i=0; i<cnt; ++i) slot_src[positions[i]] = members[starts[b]+i];
+                    break;
+                }
+                for (size_type i=0; i<cnt; ++i) taken[positions[i]/64] &= ~(1ULL << (positions[i]%64));
+            }
+        }
+        Allocator<size_type>::deallocate(positions);
+        FirstAlloc::deallocate(taken);
+        Allocator<size_type>::deallocate(order);
+        Allocator<size_type>::deallocate(members);
+        FirstAlloc::deallocate(starts);
+        Allocator<uint64_t>::deallocate(hashes);
+        return result;
+    }
+    // 由键值对(*keys[i], *values[i])构建，后出现的同键覆盖先出现的
+    bool _build(const Key** keys, const Value** values, size_type n) {
+        _release();
+        bool* dead = (bool*)FirstAlloc::clallocate(n + 1, sizeof(bool));
+        size_type* slot_src = Allocator<size_type>::allocate(n + 1);
+        int result = __build_retry;
+        for (size_type attempt=0; attempt < mystl::__frozen_max_attempts && result == __build_retry; ) {
+            size_type n_buckets = n / mystl::__frozen_bucket_keys + 1;
+            uint64_t seed = mystl::__frozen_mix(attempt + 1);
+            _blob = (char*)FirstAlloc::allocate(_blob_size(n, n_buckets));
+            size_type n_dead = 0;
+            result = _place(keys, n, n_buckets, seed, slot_src, dead, n_dead);
+            if (result == __build_ok) {
+                header_type* header = (header_type*)_blob;
+                memset(_blob, 0, mystl::__frozen_round_up(sizeof(header_type)));
+                header->magic       = mystl::__frozen_magic;
+                header->slot_size   = sizeof(slot_type);
+                header->size        = n;
+                header->n_buckets   = n_buckets;
+                header->seed        = seed;
+                _bind(_blob, true);
+                for (size_type pos=0; pos<n; ++pos) {
+                    new (&_slots[pos].key) Key(*keys[slot_src[pos]]);
+                    new (&_slots[pos].value) Value(*values[slot_src[pos]]);
+                }
+                break;
+            }
+            FirstAlloc::deallocate(_blob);
+            _blob = nullptr;
+            if (n_dead > 0) {               // 去掉被覆盖的重复键，不换种子再来
+                size_type live = 0;
+                for (size_type i=0; i<n; ++i)
+                    if (!dead[i]) { keys[live] = keys[i];  values[live] = values[i];  ++live; }
+                n = live;
+                memset(dead, 0, n * sizeof(bool));
+            }
+            else ++attempt;
+        }
+        FirstAlloc::deallocate(dead);
+        Allocator<size_type>::deallocate(slot_src);
+        if (result != __build_ok) {
+            if (result == __build_retry)
+                cerr << "warning: " << "no perfect hash found for FrozenHashMap(at " << this << ")!" << endl;
+            _release();
+            return false;
+        }
+        return true;
+    }
+
+public:     // 【构造/析构函数】
+    FrozenHashMap(): _blob(nullptr), _owned(false), _pilots(nullptr), _slots(nullptr),
+        _size(0), _n_buckets(0), _seed(0) {}
+    FrozenHashMap(const FrozenHashMap& other): FrozenHashMap() {
+        if (!other._blob) return;
+        size_type nbytes = _slots_offset(other._n_buckets);
+        char* blob = (char*)FirstAlloc::allocate(nbytes + other._size * sizeof(slot_type));
+        memcpy(blob, other._blob, nbytes);
+        _bind(blob, true);
+        for (size_type i=0; i<_size; ++i) new (_slots+i) slot_type(other._slots[i]);
+    }
+    FrozenHashMap& operator=(const FrozenHashMap& other) {
+        if (this != &other) {
+            FrozenHashMap copy(other);
+            swap(copy);
+        }
+        return *this;
+    }
+    ~FrozenHashMap() { _release(); }
+    void swap(FrozenHashMap& other) {
+        std::swap(_blob, other._blob);          std::swap(_owned, other._owned);
+        std::swap(_pilots, other._pilots);      std::swap(_slots, other._slots);
+        std::swap(_size, other._size);          std::swap(_n_buckets, other._n_buckets);
+        std::swap(_seed, other._seed);
+    }
+
+public:     // 【构建】失败时cerr警告、返回false，表为空
+    // 由HashMap<>构建
+    template <class Hasher, class Comp, class TableAlloc, class NodeAlloc>
+    bool build(const HashMap<Key, Value, Hasher, Comp, TableAlloc, NodeAlloc>& map) {
+        size_type n = map.size(), i = 0;
+        const Key** keys = Allocator<const Key*>::allocate(n + 1);
+        const Value** values = Allocator<const Value*>::allocate(n + 1);
+        for (const auto& node : map) { keys[i] = &node.key;  values[i] = &node.value;  ++i; }
+        bool ok = _build(keys, values, n);
+        Allocator<const Key*>::deallocate(keys);
+        Allocator<const Value*>::deallocate(values);
+        return ok;
+    }
+    // 由键值对数组构建，同一个键出现多次时后出现的覆盖先出现的
+    template <class Alloc>
+    bool build(const Vector<Pair<Key, Value>, Alloc>& pairs) {
+        size_type n = pairs.size();
+        const Key** keys = Allocator<const Key*>::allocate(n + 1);
+        const Value** values = Allocator<const Value*>::allocate(n + 1);
+        for (size_type i=0; i<n; ++i) { keys[i] = &pairs[i].first;  values[i] = &pairs[i].second; }
+        bool ok = _build(keys, values, n);
+        Allocator<const Key*>::deallocate(keys);
+        Allocator<const Value*>::deallocate(values);
+        return ok;
+    }
+    // 由(keys[i], values[i]), i∈[0, n)构建
+    bool build(const Key* keys, const Value* values, size_type n) {
+        const Key** key_ptrs = Allocator<const Key*>::allocate(n + 1);
+        const Value** value_ptrs = Allocator<const Value*>::allocate(n + 1);
+        for (size_type i=0; i<n; ++i) { key_ptrs[i] = keys+i;  value_ptrs[i] = values+i; }
+        bool ok = _build(key_ptrs, value_ptrs, n);
+        Allocator<const Key*>::deallocate(key_ptrs);
+        Allocator<const Value*>::deallocate(value_ptrs);
+        return ok;
+    }
+
+public:     // 【Basic Accessor】
+    size_type size()    const { return _size; }
+    bool empty()        const { return _size == 0; }
+    iterator begin()    const { return _slots; }
+    iterator end()      const { return _slots + _size; }
+
+public:     // 【查】
+    iterator find(const Key& key) const {
+        const slot_type* slot = _find_slot(key);
+        return slot ? slot : end();
+    }
+    const Value& operator[](const Key& key) const {
+        const slot_type* slot = _find_slot(key);
+        if (!slot) {
+            cerr << "warning: " << "key not found in FrozenHashMap(at " << this << ")!" << endl;
+            static const Value default_value = Value();
+            return default_value;
+        }
+        return slot->value;
+    }
+    bool contains(const Key& key)    const { return _find_slot(key) != nullptr; }
+    size_type count(const Key& key)  const { return _find_slot(key) ? 1 : 0; }
+    // 透明查找：KeyHasher与KeyCompare都声明了is_transparent时，可直接以const char*/StringView等查找，不构造临时Key
+    template <class K, class = typename __TransparentKey<KeyHasher, KeyCompare, K>::type>
+    iterator find(const K& key) const {
+        const slot_type* slot = _find_slot(key);
+        return slot ? slot : end();
+    }
+    template <class K, class = typename __TransparentKey<KeyHasher, KeyCompare, K>::type>
+    bool contains(const K& key)      const { return _find_slot(key) != nullptr; }
+    template <class K, class = typename __TransparentKey<KeyHasher, KeyCompare, K>::type>
+    size_type count(const K& key)    const { return _find_slot(key) ? 1 : 0; }
+
+public:     // 【序列化】只适用于可平凡拷贝的键、值（int、double、定长数组/结构体等，不含string）
+    // blob即整张表所在的连续内存，可直接写入文件/发送；空表（未构建）时为nullptr
+    const void* blob() const {
+        static_assert(is_trivially_copyable<slot_type>::value, "FrozenHashMap blob requires trivially copyable Key and Value");
+        return _blob;
+    }
+    size_type blob_size() const { return _blob ? _blob_size(_size, _n_buckets) : 0; }
+    bool save(const char* path) const {
+        static_assert(is_trivially_copyable<slot_type>::value, "FrozenHashMap blob requires trivially copyable Key and Value");
+        if (!_blob) {
+            cerr << "warning: " << "FrozenHashMap(at " << this << ") is not built!" << endl;
+            return false;
+        }
+        FILE* file = fopen(path, "wb");
+        if (!file) {
+            cerr << "warning: " << "cannot open " << path << " for writing!" << endl;
+            return false;
+        }
+        bool ok = fwrite(_blob, 1, blob_size(), file) == blob_size();
+        ok = fclose(file) == 0 && ok;
+        if (!ok) cerr << "warning: " << "failed to write " << path << "!" << endl;
+        return ok;
+    }
+    // 读入save()写出的文件，拷贝到自己分配的内存里
+    bool load(const char* path) {
+        static_assert(is_trivially_copyable<slot_type>::value, "FrozenHashMap blob requires trivially copyable Key and Value");
+        FILE* file = fopen(path, "rb");
+        if (!file) {
+            cerr << "warning: " << "cannot open " << path << "!" << endl;
+            return false;
+        }
+        long len = (fseek(file, 0, SEEK_END) == 0) ? ftell(file) : -1;
+        char* blob = len > 0 ? (char*)FirstAlloc::allocate((size_type)len) : nullptr;
+        bool ok = blob && fseek(file, 0, SEEK_SET) == 0 && fread(blob, 1, (size_type)len, file) == (size_type)len &&
+                  _check_blob(blob, (size_type)len);
+        fclose(file);
+        if (!ok) {
+            cerr << "warning: " << path << " is not a valid FrozenHashMap blob!" << endl;
+            FirstAlloc::deallocate(blob);
+            return false;
+        }
+        _release();
+        _bind(blob, true);
+        return true;
+    }
+    // 直接使用外部的blob（如mmap()映射的文件），不拷贝也不接管：blob须在本对象使用期间一直有效
+    bool attach(const void* blob, size_type len) {
+        static_assert(is_trivially_copyable<slot_type>::value, "FrozenHashMap blob requires trivially copyable Key and Value");
+        if (!blob || !_check_blob((const char*)blob, len)) {
+            cerr << "warning: " << "not a valid FrozenHashMap blob(at " << blob << ")!" << endl;
+            return false;
+        }
+        _release();
+        _bind((char*)blob, false);
+        return true;
+    }
+};
+
+// cout << frozen_hash_map;
+template <class Key, class Value, class KeyHasher, class KeyCompare>
+ostream& operator<<(ostream& out, const FrozenHashMap<Key, Value, KeyHasher, KeyCompare>& frozen_map) {
+    out << "{ ";
+    for (const auto& slot : frozen_map) out << slot.key << ": " << slot.value << ", ";
+    return out << "}";
+}
+
+
+#endif // __FROZEN_HASH_MAP__
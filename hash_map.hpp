@@ -1,6 +1,24 @@
+/* hash_map.hpp
+ * 【哈希映射】拉链法哈希表，平均O(1)时间增/删/查
+ * STL当中 <hash_map>/<unordered_map> 部分内容的简化版
+ *
+ * HashMap<> 与 STL unordered_map<> 的不同之处：
+ * (1)表长都是质数，以 hash % 表长 散列，即使是恒等哈希的整数键也能分布均匀
+ * (2)与java8的HashMap一样，一个桶的链表长度超过__treeify_threshold时，整条链表转为红黑树（左倾红黑树LLRB），
+ *    即使遭遇哈希洪水（大量键落入同一个桶），单次增/删/查也仍是O(logn)
+ * (3)负载因子（节点数/桶数）> __up_tol时扩容，< 1/__low_tol_inv时缩容，都是重新散列到相邻的质数表长
+ * (4)与redis的dict一样渐进式rehash：扩/缩容时新旧两个桶数组并存，之后每次插入新键/删除只迁移一个旧桶，
+ *    查找两边都找；也可以rehash_step(budget)主动推进。迁移时树桶拆回链表节点，链入新桶后过长的再树化
+ */
 #ifndef __HASH_MAP__
 #define __HASH_MAP__
+#include <initializer_list>
+#include <iostream>
+#include <cstring>
+#include <new>              // placement new
+#include <utility>          // move()
 #include "alloc.hpp"
+#include "traits.hpp"
 #include "utils.hpp"
 using namespace std;
 
@@ -8,120 +26,729 @@ using namespace std;
 #define RED     true
 #define BLACK   false
 
-// ...
+// 哈希集合的链表节点
 template <class Key>
 struct __HashSetNode {
     Key                 key;
     __HashSetNode<Key>* right;  // 即next，继承到TreeNode后即右孩子（父类指针可无条件指向派生类对象）
 };
 
-// ...
+// 哈希集合的树节点【继承链表节点，树化时把链表节点移动构造到树节点的基类部分即可】
 template <class Key>
 struct __HashSetTreeNode: __HashSetNode<Key> {
     __HashSetTreeNode<Key>* left;
     bool                    color;
 };
 
-// ...
+// 哈希映射的链表节点
 template <class Key, class Value>
-struct __HashMapNode { 
+struct __HashMapNode {
     Key                         key;
     Value                       value;
     __HashMapNode<Key, Value>*  right;
 };
 
-// ...
+// 哈希映射的树节点
 template <class Key, class Value>
 struct __HashMapTreeNode: __HashMapNode<Key, Value> {
     __HashMapTreeNode<Key, Value>*  left;
     bool                            color;
 };
 
-// 迭代器
-template <class Key, class Value>
-struct __HashMapIterator {
-    typedef __HashMapNode<Key, Value> Node;
-    Node**      bucket;
-    Node*       cur;
-    void*       obj;
+
+// 节点被挪到新地址（树化/拆树时移动构造）后调用，默认什么都不做
+// 节点还挂在别的侵入式结构上时（如LRUCache<>的最近使用链表），为其节点类型重载此函数以修补邻居的指针
+template <class Node>
+inline void __hash_node_moved(Node*, Node*) {}
+
+
+// 哈希表迭代器【it->key，it->value】
+// 链表桶沿right前进；树桶按中序前进，后继通过从树根按键下降找到（节点没有父指针）
+template <class HashTable>
+struct __HashTableIterator {
+    // 类型定义
+    typedef ForwardIteratorTag              iterator_category;  // 前向迭代器
+    typedef typename HashTable::node_type   Node;
+    typedef Node                            value_type;
+    typedef Node*                           pointer;
+    typedef Node&                           reference;
+    typedef size_t                          size_type;
+    typedef ptrdiff_t                       difference_type;
+    typedef __HashTableIterator<HashTable>  iterator;
+    // 成员变量
+    const HashTable*    table;      // 所属的哈希表
+    size_type           bucket;     // 所在的桶
+    Node*               cur;        // 当前节点，nullptr即end()
+    // 构造函数
+    __HashTableIterator(): table(nullptr), bucket(0), cur(nullptr) {}
+    __HashTableIterator(const HashTable* tb, size_type bkt, Node* node):
+        table(tb), bucket(bkt), cur(node) {}
+    // *self, ->self, self==other, self!=other
+    Node& operator*()  const { return *cur; }
+    Node* operator->() const { return cur; }
+    bool operator==(const iterator& other) const { return cur == other.cur; }
+    bool operator!=(const iterator& other) const { return cur != other.cur; }
+    // ++self, self++
+    iterator& operator++()
+        { table->_next(bucket, cur);  return *this; }
+    iterator operator++(int)
+        { iterator tmp(*this);  table->_next(bucket, cur);  return tmp; }
 };
 
-// """哈希映射[STL unordered_map<>]"""
-template <class Key, 
-          class Value, 
-          class KeyHasher   = HashCode<Key>, 
-          class KeyCompare  = Compare<Key>, 
-          class TableAlloc  = FirstAlloc, 
-          class NodeAlloc   = SecondAlloc>
-class HashMap {
+
+// """哈希表"""
+// HashMap<>与HashSet<>共同的基类，Node/TreeNode需有key、right（以及left、color）成员
+template <class Node,
+          class TreeNode,
+          class Key,
+          class KeyHasher,
+          class KeyCompare,
+          class TableAlloc,
+          class NodeAlloc>
+class __HashTable {
 
 public:     // 【类型定义】
-    typedef Pair<Key, Value>    value_type;
     typedef size_t              size_type;          // 64位编译器为unsigned long long，32位编译器为unsigned long
     typedef ptrdiff_t           difference_type;    // 64位编译器为long long，32位编译器为long，表示两个迭代器间的距离
-    // pointer? reference?
-    typedef __HashMapIterator<Key, Value>   iterator;
-    typedef __HashMapNode<Key, Value>       Node;
-    typedef __HashMapTreeNode<Key, Value>   TreeNode;
+    typedef Node                node_type;
+    typedef __HashTable<Node, TreeNode, Key, KeyHasher, KeyCompare, TableAlloc, NodeAlloc> self;
+    typedef __HashTableIterator<self>       iterator;
     typedef Allocator<Node*, TableAlloc>    table_allocator;
-    typedef Allocator<Node, NodeAlloc>      node_allocator;
     typedef Allocator<bool, TableAlloc>     treetag_allocator;
+    typedef Allocator<Node, NodeAlloc>      node_allocator;
     typedef Allocator<TreeNode, NodeAlloc>  treenode_allocator;
+    friend struct __HashTableIterator<self>;
 
-private:    // 【成员变量】
-    static const size_type __up_tol = 10;   // 负载因子上限，即当node/bucket > 10时，rehash(next_table_size())
-    static const size_type __low_tol = 1;   // 负载因子下限，即当node/bucket < 1时，rehash(prev_table_size())
-    static constexpr size_type __table_sizes[28] = { 53, 97, 193, 389, 769, 1543, 3079, 6151, 
-                                                     12289, 24593, 49157, 98317, 196613, 393241, 
-                                                     786433, 1572869, 3145739, 6291469, 12582917, 
-                                                     25165843, 50331653, 100663319, 201326611, 
+protected:  // 【成员变量】
+    static const size_type __up_tol = 1;                // 负载因子上限，即当node/bucket > 1时，rehash(next_table_size())
+    static const size_type __low_tol_inv = 8;           // 负载因子下限的倒数，即当node/bucket < 1/8时，rehash(prev_table_size())
+    static const size_type __treeify_threshold = 16;    // 链表长度超过此值则树化【哈希值均匀时链长近似泊松分布(λ<=1)，几乎不可能这么长】
+    static const size_type __n_table_sizes = 28;
+    static constexpr size_type __table_sizes[__n_table_sizes] = {
+                                                     53, 97, 193, 389, 769, 1543, 3079, 6151,
+                                                     12289, 24593, 49157, 98317, 196613, 393241,
+                                                     786433, 1572869, 3145739, 6291469, 12582917,
+                                                     25165843, 50331653, 100663319, 201326611,
                                                      402653189, 805306457, 1610612741, 3221225473UL,
                                                      4294967291UL };  // 哈希表长度【都是质数，用于取模散列】
-    KeyCompare  _compare;       // ...
-    KeyHasher   _hasher;        // ...
-    Node**      _hash_table;    // ...
-    size_type   _table_size;    // ...
-    size_type   _size;          // ...
-    bool*       _istree;        // ...
-
-private:    // 【rehash】
+    KeyCompare  _compare;       // 键的三路比较器，用于链表查找与树桶
+    KeyHasher   _hasher;        // 键的哈希函数
+    Node**      _hash_table;    // 桶数组：链表头 或 树根（TreeNode*）
+    size_type   _table_size;    // 桶数
+    size_type   _size;          // 节点数
+    bool*       _istree;        // _istree[i]即第i个桶是否已树化
+    Node**      _old_table;         // 渐进式rehash期间的旧桶数组，不在rehash时为nullptr
+    bool*       _old_istree;        // 旧桶数组的树化标记
+    size_type   _old_table_size;    // 旧桶数，不在rehash时为0
+    size_type   _rehash_idx;        // 旧桶数组中[0, _rehash_idx)已迁移完毕
+
+protected:  // 【rehash】
     size_type _next_table_size() const {
-        for (const size_type* cur=__table_sizes; cur<__table_sizes+28; ++cur)
-            if (*cur == _table_size) return *(++cur);
-        return (size_type)0;
+        for (size_type i=0; i+1<__n_table_sizes; ++i)
+            if (__table_sizes[i] == _table_size) return __table_sizes[i+1];
+        return _table_size;     // 已是最大表长
     }
     size_type _prev_table_size() const {
-        for (const size_type* cur=__table_sizes; cur<__table_sizes+28; ++cur)
-            if (*cur == _table_size) return *(--cur);
-        return (size_type)0;
+        for (size_type i=1; i<__n_table_sizes; ++i)
+            if (__table_sizes[i] == _table_size) return __table_sizes[i-1];
+        return _table_size;     // 已是最小表长
+    }
+    // 开始渐进式rehash：只新建table_size个桶，旧桶数组里的节点留待之后的增/删操作逐步迁移
+    // 这样扩/缩容不会在某一次操作中集中迁移全部节点（大表上可达数十毫秒的停顿）
+    void _rehash(size_type table_size) {
+        if (table_size == _table_size) return;
+        if (_old_table) _rehash_finish();           // 上一轮还没迁移完，先一次迁完
+        _old_table      = _hash_table;
+        _old_istree     = _istree;
+        _old_table_size = _table_size;
+        _rehash_idx     = 0;
+        _hash_table     = table_allocator::clallocate(table_size);
+        _istree         = treetag_allocator::clallocate(table_size);
+        _table_size     = table_size;
+    }
+    void _rehash_finish() { while (rehash_step(_old_table_size)) {} }
+    // 把旧桶bucket的节点全部迁入新桶数组：树桶先拆回链表节点
+    void _migrate_bucket(size_type bucket) {
+        if (_old_istree[bucket])
+            _untreeify((TreeNode*)_old_table[bucket]);
+        else {
+            Node *cur=_old_table[bucket], *next;
+            for (; cur; cur=next) { next=cur->right;  _link_node(cur); }
+        }
+        _old_table[bucket] = nullptr;
+        _old_istree[bucket] = false;
+    }
+    // 把一个游离的链表节点链入新桶数组，链表过长则树化
+    void _link_node(Node* node) {
+        size_type bucket = hash(node->key);
+        if (_istree[bucket]) {
+            TreeNode* root = _tree_insert((TreeNode*)_hash_table[bucket], _to_tree_node(node));
+            root->color = BLACK;
+            _hash_table[bucket] = root;
+            return;
+        }
+        node->right = _hash_table[bucket];
+        _hash_table[bucket] = node;
+        size_type len = 0;
+        for (; node && len<=__treeify_threshold; node=node->right) ++len;
+        if (len > __treeify_threshold) _treeify(bucket);
+    }
+
+public:     // 【渐进式rehash】
+    // 推进一步：至多迁移budget个非空旧桶（途经的空桶至多10*budget个），返回是否仍在rehash
+    // 插入新键、删除时会自动各推进一步；空闲时（如后台定时）也可主动调用，提前迁完
+    bool rehash_step(size_type budget = 1) {
+        if (!_old_table) return false;
+        size_type empty_visits = budget * 10;
+        while (budget > 0 && _rehash_idx < _old_table_size) {
+            if (_old_table[_rehash_idx]) { _migrate_bucket(_rehash_idx);  --budget; }
+            else if (empty_visits-- == 0) break;
+            ++_rehash_idx;
+        }
+        if (_rehash_idx < _old_table_size) return true;
+        table_allocator::deallocate(_old_table);        // 迁移完毕
+        treetag_allocator::deallocate(_old_istree);
+        _old_table = nullptr;
+        _old_istree = nullptr;
+        _old_table_size = 0;
+        _rehash_idx = 0;
+        return false;
+    }
+    bool rehashing() const { return _old_table != nullptr; }
+    // 预留桶数，之后共有n个节点以内都不会再扩容；需要扩容时一次迁移完毕【批量插入前调用，省掉中途的多轮rehash】
+    void reserve(size_type n) {
+        size_type table_size = __table_sizes[__n_table_sizes-1];
+        for (size_type i=0; i<__n_table_sizes; ++i)
+            if (__table_sizes[i] * __up_tol >= n) { table_size = __table_sizes[i];  break; }
+        if (table_size <= _table_size) return;
+        _rehash(table_size);
+        _rehash_finish();
     }
-    void _rehash(size_type table_size) {;}
 
 public:     // 【构造/析构函数】
-    HashMap(): 
+    __HashTable():
         _hash_table(table_allocator::clallocate(__table_sizes[0])),
         _table_size(__table_sizes[0]), _size(0),
-        _istree(treetag_allocator::clallocate(__table_sizes[0])) {}
-    ~HashMap() {
+        _istree(treetag_allocator::clallocate(__table_sizes[0])),
+        _old_table(nullptr), _old_istree(nullptr), _old_table_size(0), _rehash_idx(0) {}
+    ~__HashTable() {
         clear();
         table_allocator::deallocate(_hash_table);
+        treetag_allocator::deallocate(_istree);
     }
 
 public:     // 【Basic Accessor】
-    size_type size() const { return _size; }
-    bool empty()     const { return _size==0; }
-    size_type hash(const Key& key) const            // 减少访问静态区的__table_sizes[]，
-        { return (_hasher(key) & _table_size); }    // 充分利用局部性原理
+    size_type size()        const { return _size; }
+    bool empty()            const { return _size==0; }
+    size_type bucket_count()const { return _table_size; }
+    size_type hash(const Key& key) const { return _hasher(key) % _table_size; }
+    iterator begin() const {
+        for (size_type i=0; i<_old_table_size+_table_size; ++i)
+            if (_bucket_head(i)) return iterator(this, i, _bucket_first(i));
+        return end();
+    }
+    iterator end() const { return iterator(); }
+
+public:     // 【删】
+    void clear() {
+        if (_old_table) {
+            _destroy_buckets(_old_table, _old_istree, _old_table_size);
+            table_allocator::deallocate(_old_table);
+            treetag_allocator::deallocate(_old_istree);
+            _old_table = nullptr;
+            _old_istree = nullptr;
+            _old_table_size = 0;
+            _rehash_idx = 0;
+        }
+        _destroy_buckets(_hash_table, _istree, _table_size);
+        if (_table_size != __table_sizes[0]) {      // 表长回到最小
+            table_allocator::deallocate(_hash_table);
+            treetag_allocator::deallocate(_istree);
+            _table_size = __table_sizes[0];
+            _hash_table = table_allocator::clallocate(_table_size);
+            _istree = treetag_allocator::clallocate(_table_size);
+        }
+        else {
+            memset(_hash_table, 0, _table_size*sizeof(Node*));
+            memset(_istree, 0, _table_size*sizeof(bool));
+        }
+        _size = 0;
+    }
+
+protected:  // 【交换两个哈希表，浅拷贝交换！】派生类有自己的成员时须一并交换，故不直接公开
+    void swap(self& other) {
+        std::swap(_compare, other._compare);                std::swap(_hasher, other._hasher);
+        std::swap(_hash_table, other._hash_table);          std::swap(_table_size, other._table_size);
+        std::swap(_size, other._size);                      std::swap(_istree, other._istree);
+        std::swap(_old_table, other._old_table);            std::swap(_old_istree, other._old_istree);
+        std::swap(_old_table_size, other._old_table_size);  std::swap(_rehash_idx, other._rehash_idx);
+    }
+
+protected:  // 【构造/析构节点】
+    static void _destroy_buckets(Node** table, bool* istree, size_type table_size) {
+        for (size_type i=0; i<table_size; ++i) {
+            if (istree[i])
+                _destroy_tree((TreeNode*)table[i]);
+            else {
+                Node *cur=table[i], *next;
+                for (; cur; cur=next) { next=cur->right;  _destroy_node(cur); }
+            }
+        }
+    }
+    static Node* _make_node(const Key& key) {
+        Node* node = node_allocator::allocate();
+        new (node) Node();
+        node->key = key;
+        node->right = nullptr;
+        return node;
+    }
+    static void _destroy_node(Node* node) {
+        node->~Node();
+        node_allocator::deallocate(node);
+    }
+    static TreeNode* _make_tree_node(const Key& key) {
+        TreeNode* node = treenode_allocator::allocate();
+        new (node) TreeNode();
+        node->key = key;
+        node->right = nullptr;
+        node->left = nullptr;
+        node->color = RED;
+        return node;
+    }
+    static void _destroy_tree_node(TreeNode* node) {
+        node->~TreeNode();
+        treenode_allocator::deallocate(node);
+    }
+    static void _destroy_tree(TreeNode* root) {
+        if (!root) return;
+        _destroy_tree(root->left);
+        _destroy_tree((TreeNode*)root->right);
+        _destroy_tree_node(root);
+    }
+    // 链表节点 <=> 树节点：把公共部分移动构造过去，不深拷贝键值
+    // 【这里不能memcpy：string等类型的短串存在对象内部、自带指向自身的指针（SSO），按位搬家后会悬空】
+    static TreeNode* _to_tree_node(Node* node) {
+        TreeNode* tree_node = treenode_allocator::allocate();
+        new ((Node*)tree_node) Node(std::move(*node));
+        __hash_node_moved(node, (Node*)tree_node);
+        _destroy_node(node);
+        tree_node->right = nullptr;
+        tree_node->left = nullptr;
+        tree_node->color = RED;
+        return tree_node;
+    }
+    static Node* _to_list_node(TreeNode* tree_node) {
+        Node* node = node_allocator::allocate();
+        new (node) Node(std::move(*(Node*)tree_node));
+        __hash_node_moved((Node*)tree_node, node);
+        _destroy_tree_node(tree_node);
+        node->right = nullptr;
+        return node;
+    }
+
+protected:  // 【树桶：左倾红黑树LLRB】
+    static bool _is_red(TreeNode* node) { return node && node->color == RED; }
+    static TreeNode* _right_of(TreeNode* node) { return (TreeNode*)node->right; }
+    static TreeNode* _left_rotate(TreeNode* opnode) {
+        TreeNode* x = _right_of(opnode);
+        opnode->right = x->left;
+        x->left = opnode;
+        x->color = opnode->color;
+        opnode->color = RED;
+        return x;
+    }
+    static TreeNode* _right_rotate(TreeNode* opnode) {
+        TreeNode* x = opnode->left;
+        opnode->left = _right_of(x);
+        x->right = opnode;
+        x->color = opnode->color;
+        opnode->color = RED;
+        return x;
+    }
+    static void _flip_colors(TreeNode* opnode) {
+        opnode->color = !opnode->color;
+        opnode->left->color = !opnode->left->color;
+        _right_of(opnode)->color = !_right_of(opnode)->color;
+    }
+    static TreeNode* _balance(TreeNode* opnode) {
+        if (_is_red(_right_of(opnode)) && !_is_red(opnode->left)) opnode = _left_rotate(opnode);
+        if (_is_red(opnode->left) && _is_red(opnode->left->left)) opnode = _right_rotate(opnode);
+        if (_is_red(opnode->left) && _is_red(_right_of(opnode))) _flip_colors(opnode);
+        return opnode;
+    }
+    static TreeNode* _move_red_left(TreeNode* opnode) {
+        _flip_colors(opnode);
+        if (_is_red(_right_of(opnode)->left)) {
+            opnode->right = _right_rotate(_right_of(opnode));
+            opnode = _left_rotate(opnode);
+            _flip_colors(opnode);
+        }
+        return opnode;
+    }
+    static TreeNode* _move_red_right(TreeNode* opnode) {
+        _flip_colors(opnode);
+        if (_is_red(opnode->left->left)) {
+            opnode = _right_rotate(opnode);
+            _flip_colors(opnode);
+        }
+        return opnode;
+    }
+    // 将键不重复的node插入以opnode为根的子树，返回新的子树根
+    TreeNode* _tree_insert(TreeNode* opnode, TreeNode* node) {
+        if (!opnode) return node;
+        if (_compare(node->key, opnode->key) < 0)
+            opnode->left = _tree_insert(opnode->left, node);
+        else
+            opnode->right = _tree_insert(_right_of(opnode), node);
+        return _balance(opnode);
+    }
+    // 摘下子树中最小的节点（存入min_node），返回新的子树根
+    TreeNode* _tree_erase_min(TreeNode* opnode, TreeNode*& min_node) {
+        if (!opnode->left) { min_node = opnode;  return nullptr; }
+        if (!_is_red(opnode->left) && !_is_red(opnode->left->left))
+            opnode = _move_red_left(opnode);
+        opnode->left = _tree_erase_min(opnode->left, min_node);
+        return _balance(opnode);
+    }
+    // 删除子树中键为key的节点（须确定存在），返回新的子树根
+    // 删除内部节点时，把右子树的最小节点摘下来顶替它的位置，而不是拷贝键值
+    TreeNode* _tree_erase(TreeNode* opnode, const Key& key) {
+        if (_compare(key, opnode->key) < 0) {
+            if (!_is_red(opnode->left) && !_is_red(opnode->left->left))
+                opnode = _move_red_left(opnode);
+            opnode->left = _tree_erase(opnode->left, key);
+        }
+        else {
+            if (_is_red(opnode->left)) opnode = _right_rotate(opnode);
+            if (_compare(key, opnode->key) == 0 && !opnode->right) {
+                _destroy_tree_node(opnode);         // LLRB中没有右孩子的节点也没有左孩子
+                return nullptr;
+            }
+            if (!_is_red(_right_of(opnode)) && !_is_red(_right_of(opnode)->left))
+                opnode = _move_red_right(opnode);
+            if (_compare(key, opnode->key) == 0) {
+                TreeNode* min_node;
+                TreeNode* right = _tree_erase_min(_right_of(opnode), min_node);
+                min_node->left = opnode->left;
+                min_node->right = right;
+                min_node->color = opnode->color;
+                _destroy_tree_node(opnode);
+                opnode = min_node;
+            }
+            else opnode->right = _tree_erase(_right_of(opnode), key);
+        }
+        return _balance(opnode);
+    }
+    template <class K>
+    TreeNode* _tree_find(TreeNode* opnode, const K& key) const {
+        while (opnode) {
+            int cmp = _compare(key, opnode->key);
+            if (cmp == 0) return opnode;
+            opnode = cmp < 0 ? opnode->left : _right_of(opnode);
+        }
+        return nullptr;
+    }
+    // 中序后继：键大于key的最小节点
+    TreeNode* _tree_successor(TreeNode* opnode, const Key& key) const {
+        TreeNode* succ = nullptr;
+        while (opnode) {
+            if (_compare(key, opnode->key) < 0) { succ = opnode;  opnode = opnode->left; }
+            else opnode = _right_of(opnode);
+        }
+        return succ;
+    }
+    // 链表 => 红黑树
+    void _treeify(size_type bucket) {
+        Node *cur=_hash_table[bucket], *next;
+        TreeNode* root = nullptr;
+        for (; cur; cur=next) {
+            next = cur->right;
+            root = _tree_insert(root, _to_tree_node(cur));
+            root->color = BLACK;
+        }
+        _hash_table[bucket] = root;
+        _istree[bucket] = true;
+    }
+    // 红黑树 => 链表节点，逐个链入新桶数组
+    void _untreeify(TreeNode* opnode) {
+        if (!opnode) return;
+        TreeNode *left=opnode->left, *right=_right_of(opnode);
+        _link_node(_to_list_node(opnode));
+        _untreeify(left);
+        _untreeify(right);
+    }
+
+protected:  // 【迭代器支持】
+    // rehash期间旧桶数组在前、新桶数组在后，统一编号为[0, _old_table_size+_table_size)
+    Node* _bucket_head(size_type bucket) const {
+        return bucket < _old_table_size ? _old_table[bucket] : _hash_table[bucket-_old_table_size];
+    }
+    bool _bucket_istree(size_type bucket) const {
+        return bucket < _old_table_size ? _old_istree[bucket] : _istree[bucket-_old_table_size];
+    }
+    Node* _bucket_first(size_type bucket) const {
+        Node* node = _bucket_head(bucket);
+        if (_bucket_istree(bucket) && node)
+            while (((TreeNode*)node)->left) node = ((TreeNode*)node)->left;
+        return node;
+    }
+    void _next(size_type& bucket, Node*& cur) const {
+        cur = _bucket_istree(bucket) ?
+            _tree_successor((TreeNode*)_bucket_head(bucket), cur->key) : cur->right;
+        while (!cur && ++bucket < _old_table_size+_table_size)
+            cur = _bucket_first(bucket);
+    }
+
+protected:  // 【增、删、查】
+    // 查找函数都以K为模板参数：K通常即Key，KeyHasher/KeyCompare透明时也可以是const char*、StringView等
+    template <class K>
+    Node* _find_in(Node* head, bool istree, const K& key) const {
+        if (istree) return _tree_find((TreeNode*)head, key);
+        while (head && _compare(head->key, key) != 0) head = head->right;
+        return head;
+    }
+    // 查找键为key（哈希值为hash_code）的节点，bucket返回其所在桶的统一编号
+    template <class K>
+    Node* _find_node(const K& key, size_type hash_code, size_type& bucket) const
+        { return _find_node(key, hash_code, hash_code % _table_size, bucket); }
+    // idx即hash_code % _table_size，已算出时不必再做一次除法
+    template <class K>
+    Node* _find_node(const K& key, size_type hash_code, size_type idx, size_type& bucket) const {
+        bucket = _old_table_size + idx;
+        Node* node = _find_in(_hash_table[idx], _istree[idx], key);
+        if (!node && _old_table) {                  // 尚未迁移的键仍在旧桶数组里
+            idx = hash_code % _old_table_size;
+            if (idx >= _rehash_idx && (node = _find_in(_old_table[idx], _old_istree[idx], key)))
+                bucket = idx;
+        }
+        return node;
+    }
+    template <class K>
+    Node* _find_node(const K& key, size_type& bucket) const { return _find_node(key, _hasher(key), bucket); }
+    template <class K>
+    Node* _find_node(const K& key) const { size_type bucket;  return _find_node(key, _hasher(key), bucket); }
+    // 返回键为key的节点，不存在则插入一个（值初始化的）新节点
+    Node* _insert_node(const Key& key) { return _insert_node(key, _hasher(key)); }
+    Node* _insert_node(const Key& key, size_type hash_code) {
+        size_type bucket;
+        Node* node = _find_node(key, hash_code, bucket);
+        if (node) return node;
+        // 此时key不在表中，不可能引用某个节点的键，推进rehash（可能挪动节点）才是安全的
+        // 先推进/扩容再插入，之后返回的节点指针不会再被挪动
+        if (_old_table) rehash_step();
+        else if (_size >= __up_tol * _table_size) _rehash(_next_table_size());
+        bucket = hash_code % _table_size;
+        ++_size;
+        if (_istree[bucket]) {
+            TreeNode* tree_node = _make_tree_node(key);
+            TreeNode* root = _tree_insert((TreeNode*)_hash_table[bucket], tree_node);
+            root->color = BLACK;
+            _hash_table[bucket] = root;
+            return tree_node;
+        }
+        node = _make_node(key);
+        node->right = _hash_table[bucket];
+        _hash_table[bucket] = node;
+        size_type len = 0;
+        for (Node* cur=node; cur && len<=__treeify_threshold; cur=cur->right) ++len;
+        if (len > __treeify_threshold) {            // 链表过长，树化后节点地址变了，需重新查找
+            _treeify(bucket);
+            node = _tree_find((TreeNode*)_hash_table[bucket], key);
+        }
+        return node;
+    }
+    // 从table的第bucket个桶中删除键为key的节点，返回删除的个数（0或1）
+    size_type _erase_in(Node** table, bool* istree, size_type bucket, const Key& key) {
+        if (istree[bucket]) {
+            TreeNode* root = (TreeNode*)table[bucket];
+            if (!_tree_find(root, key)) return 0;
+            if (!_is_red(root->left) && !_is_red(_right_of(root))) root->color = RED;
+            root = _tree_erase(root, key);
+            if (root) root->color = BLACK;
+            else istree[bucket] = false;
+            table[bucket] = root;
+        }
+        else {
+            Node** link = &table[bucket];
+            while (*link && _compare((*link)->key, key) != 0) link = &((*link)->right);
+            if (!*link) return 0;
+            Node* node = *link;
+            *link = node->right;
+            _destroy_node(node);
+        }
+        return 1;
+    }
+    // 删除键为key的节点，返回删除的个数（0或1）【删除完才推进rehash，key可能正引用着被迁移的节点】
+    size_type _erase_node(const Key& key) {
+        size_type hash_code = _hasher(key);
+        size_type erased = _erase_in(_hash_table, _istree, hash_code % _table_size, key);
+        if (!erased && _old_table && hash_code % _old_table_size >= _rehash_idx)
+            erased = _erase_in(_old_table, _old_istree, hash_code % _old_table_size, key);
+        _size -= erased;
+        if (_old_table) rehash_step();
+        else if (erased && _size * __low_tol_inv < _table_size && _table_size > __table_sizes[0])
+            _rehash(_prev_table_size());
+        return erased;
+    }
+
+protected:  // 【批量查找/插入】
+    // 随机查找大表时，每个键都要等两次cache miss（桶槽位、节点），逐个查找时这些等待是串行的
+    // 改为三级软件流水线，第i步同时处理三个键：
+    // 解析键i-2D（其桶槽位与节点都已预取）；预取键i-D的链表头/树根节点；计算键i的哈希值并预取其桶槽位
+    static const size_type __batch_distance = 8;    // 流水线相邻两级之间隔开的键数D
+    // 对keys[0, n)逐个调用visit(i, node)，node为键keys[i]的节点，不存在则为nullptr
+    // 【keys是键数组，或是任何能以keys[i]取键的对象（如指向各键的指针数组的包装）】
+    template <class KeyArray, class Visitor>
+    void _find_batch(KeyArray keys, size_type n, Visitor visit) const {
+        const size_type D = __batch_distance;
+        size_type hashes[2*D], idxs[2*D];           // 环形缓冲：已算出哈希值（及桶号）、尚未解析的键
+        for (size_type i=0; i < n + 2*D; ++i) {
+            if (i >= 2*D && i-2*D < n) {            // 先解析再覆盖：键i与键i-2D共用同一格
+                size_type j = i-2*D, bucket;
+                visit(j, _find_node(keys[j], hashes[j % (2*D)], idxs[j % (2*D)], bucket));
+            }
+            if (i >= D && i-D < n)
+                __prefetch(_hash_table[idxs[(i-D) % (2*D)]]);
+            if (i < n) {
+                hashes[i % (2*D)] = _hasher(keys[i]);
+                idxs[i % (2*D)] = hashes[i % (2*D)] % _table_size;
+                __prefetch(_hash_table + idxs[i % (2*D)]);
+            }
+        }
+    }
+    // 对keys[0, n)逐个调用visit(i, node)，node为键keys[i]的节点（不存在则先插入）
+    // 插入可能触发rehash，预取的地址随之失效，但只是白白预取而已，每一级都按当前表长重新取模
+    template <class Visitor>
+    void _insert_batch(const Key* keys, size_type n, Visitor visit) {
+        const size_type D = __batch_distance;
+        size_type hashes[2*D];
+        for (size_type i=0; i < n + 2*D; ++i) {
+            if (i >= 2*D && i-2*D < n) {
+                size_type j = i-2*D;
+                visit(j, _insert_node(keys[j], hashes[j % (2*D)]));
+            }
+            if (i >= D && i-D < n)
+                __prefetch(_hash_table[hashes[(i-D) % (2*D)] % _table_size]);
+            if (i < n) {
+                hashes[i % (2*D)] = _hasher(keys[i]);
+                __prefetch(_hash_table + hashes[i % (2*D)] % _table_size);
+            }
+        }
+    }
+};
+template <class Node, class TreeNode, class Key, class KeyHasher, class KeyCompare, class TableAlloc, class NodeAlloc>
+constexpr typename __HashTable<Node, TreeNode, Key, KeyHasher, KeyCompare, TableAlloc, NodeAlloc>::size_type
+__HashTable<Node, TreeNode, Key, KeyHasher, KeyCompare, TableAlloc, NodeAlloc>::__table_sizes[];
+
+
+// """哈希映射[STL unordered_map<>]"""
+template <class Key,
+          class Value,
+          class KeyHasher   = HashCode<Key>,
+          class KeyCompare  = Compare<Key>,
+          class TableAlloc  = FirstAlloc,
+          class NodeAlloc   = SecondAlloc>
+class HashMap: public __HashTable<__HashMapNode<Key, Value>, __HashMapTreeNode<Key, Value>,
+                                  Key, KeyHasher, KeyCompare, TableAlloc, NodeAlloc> {
+
+public:     // 【类型定义】
+    typedef Pair<Key, Value>    value_type;
+    typedef size_t              size_type;
+    typedef ptrdiff_t           difference_type;
+    typedef __HashMapNode<Key, Value>       Node;
+    typedef __HashMapTreeNode<Key, Value>   TreeNode;
+    typedef __HashTable<Node, TreeNode, Key, KeyHasher, KeyCompare, TableAlloc, NodeAlloc> base;
+    typedef typename base::iterator         iterator;
+
+public:     // 【构造/析构函数】
+    HashMap() {}
+    HashMap(initializer_list<value_type> init_list) {
+        for (const auto& item : init_list)
+            insert(item.first, item.second);
+    }
+    HashMap(const HashMap& other) {
+        this->reserve(other.size());
+        for (const Node& node : other)
+            insert(node.key, node.value);
+    }
+    HashMap& operator=(const HashMap& other) {
+        if (this != &other) {
+            HashMap copy(other);
+            this->swap(copy);
+        }
+        return *this;
+    }
+    using base::swap;
 
 public:     // 【增、改、查】
-    void insert(const Key& key, const Value& value) {}
-    const Value& operator[](const Key& key) const {}
-    Value& operator[](const Key& key) {}
+    // 插入键值对，键已存在则覆盖其值
+    void insert(const Key& key, const Value& value)
+        { this->_insert_node(key)->value = value; }
+    // 键不存在时插入Value()
+    Value& operator[](const Key& key)
+        { return this->_insert_node(key)->value; }
+    const Value& operator[](const Key& key) const {
+        const Node* node = this->_find_node(key);
+        if (!node) {
+            cerr << "warning: " << "key not found in HashMap(at " << this << ")!" << endl;
+            static const Value default_value = Value();
+            return default_value;
+        }
+        return node->value;
+    }
+    iterator find(const Key& key) const {
+        size_type bucket;
+        Node* node = this->_find_node(key, bucket);
+        return node ? iterator(this, bucket, node) : this->end();
+    }
+    bool contains(const Key& key)    const { return this->_find_node(key) != nullptr; }
+    size_type count(const Key& key)  const { return this->_find_node(key) ? 1 : 0; }
+    // 透明查找：KeyHasher与KeyCompare都声明了is_transparent时，可直接以const char*/StringView等查找，不构造临时Key
+    template <class K, class = typename __TransparentKey<KeyHasher, KeyCompare, K>::type>
+    iterator find(const K& key) const {
+        size_type bucket;
+        Node* node = this->_find_node(key, bucket);
+        return node ? iterator(this, bucket, node) : this->end();
+    }
+    template <class K, class = typename __TransparentKey<KeyHasher, KeyCompare, K>::type>
+    bool contains(const K& key)      const { return this->_find_node(key) != nullptr; }
+    template <class K, class = typename __TransparentKey<KeyHasher, KeyCompare, K>::type>
+    size_type count(const K& key)    const { return this->_find_node(key) ? 1 : 0; }
+
+public:     // 【批量查找/插入】以软件流水线预取，让多个cache miss重叠【一批上千个键时效果最好】
+    // out[i]即键keys[i]对应值的指针，不存在则为nullptr；返回找到的个数
+    size_type find_batch(const Key* keys, size_type n, Value** out) const {
+        size_type found = 0;
+        this->_find_batch(keys, n, [&](size_type i, Node* node) {
+            out[i] = node ? &node->value : nullptr;
+            found += node != nullptr;
+        });
+        return found;
+    }
+    template <class K, class = typename __TransparentKey<KeyHasher, KeyCompare, K>::type>
+    size_type find_batch(const K* keys, size_type n, Value** out) const {
+        size_type found = 0;
+        this->_find_batch(keys, n, [&](size_type i, Node* node) {
+            out[i] = node ? &node->value : nullptr;
+            found += node != nullptr;
+        });
+        return found;
+    }
+    // 依次插入(keys[i], values[i])，键已存在则覆盖其值
+    void insert_batch(const Key* keys, const Value* values, size_type n)
+        { this->_insert_batch(keys, n, [&](size_type i, Node* node) { node->value = values[i]; }); }
 
 public:     // 【删】
-    void earse(const Key& key) {}
-    void clear() {}
+    size_type erase(const Key& key) { return this->_erase_node(key); }
 };
 
+// cout << hash_map;
+template <class Key, class Value, class KeyHasher, class KeyCompare, class TableAlloc, class NodeAlloc>
+ostream& operator<<(ostream& out, const HashMap<Key, Value, KeyHasher, KeyCompare, TableAlloc, NodeAlloc>& hash_map) {
+    out << "{ ";
+    for (const auto& node : hash_map) out << node.key << ": " << node.value << ", ";
+    return out << "}";
+}
+
 
-#endif // __HASH_MAP__
\ No newline at end of file
+#endif // __HASH_MAP__
@@ -0,0 +1,206 @@
+/* hash_set.hpp
+ * 【哈希集合】与HashMap<>共用__HashTable<>（拉链法、树化桶、渐进式rehash），节点只有键
+ * STL当中 <hash_set>/<unordered_set> 部分内容的简化版，集合运算仿python的set
+ *
+ * 集合运算：
+ * (1)总是遍历较小的集合、在较大的集合里查（small-into-large），代价O(min(m, n))而不是O(m+n)
+ * (2)查找按块批量进行：先收集一块键，再用__HashTable<>::_find_batch()的软件流水线预取，让大量cache miss重叠
+ * (3)结果集合先reserve()好桶数，插入时不会中途扩容
+ */
+#ifndef __HASH_SET__
+#define __HASH_SET__
+#include <initializer_list>
+#include <iostream>
+#include "alloc.hpp"
+#include "utils.hpp"
+#include "vector.hpp"
+#include "hash_map.hpp"
+using namespace std;
+
+
+// 指向各键的指针数组，以keys[i]取键【供_find_batch()批量查找，不必拷贝键】
+template <class Key>
+struct __HashSetKeyRefs {
+    const Key* const* ptrs;
+    const Key& operator[](size_t i) const { return *ptrs[i]; }
+};
+
+
+// """哈希集合"""
+template <class Key,
+          class KeyHasher   = HashCode<Key>,
+          class KeyCompare  = Compare<Key>,
+          class TableAlloc  = FirstAlloc,
+          class NodeAlloc   = SecondAlloc>
+class HashSet: public __HashTable<__HashSetNode<Key>, __HashSetTreeNode<Key>,
+                                  Key, KeyHasher, KeyCompare, TableAlloc, NodeAlloc> {
+
+public:     // 【类型定义】
+    typedef Key                 value_type;
+    typedef size_t              size_type;
+    typedef ptrdiff_t           difference_type;
+    typedef __HashSetNode<Key>      Node;
+    typedef __HashSetTreeNode<Key>  TreeNode;
+    typedef __HashTable<Node, TreeNode, Key, KeyHasher, KeyCompare, TableAlloc, NodeAlloc> base;
+    typedef typename base::iterator iterator;
+    static const size_type __probe_chunk = 256;     // 批量查找时每块的键数
+
+private:    // 【集合运算的公共部分】
+    // 对本集合的每个键key调用func(key, other中是否有key)【按块批量查找other】
+    template <class Function>
+    void _probe(const HashSet& other, Function func) const {
+        const Key* ptrs[__probe_chunk];
+        __HashSetKeyRefs<Key> refs = { ptrs };
+        size_type cnt = 0;
+        auto flush = [&]() {
+            other._find_batch(refs, cnt, [&](size_type i, Node* node) { func(*ptrs[i], node != nullptr); });
+            cnt = 0;
+        };
+        for (const Node& node : *this) {
+            ptrs[cnt++] = &node.key;
+            if (cnt == __probe_chunk) flush();
+        }
+        if (cnt > 0) flush();
+    }
+
+public:     // 【构造函数】
+    HashSet() {}
+    HashSet(initializer_list<Key> init_list) {
+        this->reserve(init_list.size());
+        for (const auto& key : init_list) insert(key);
+    }
+    // 由键数组批量构建：先预留桶数，再以批量插入预取
+    template <class Alloc>
+    explicit HashSet(const Vector<Key, Alloc>& keys) { insert_batch(keys.begin(), keys.size()); }
+    HashSet(const HashSet& other) {
+        this->reserve(other.size());
+        for (const Node& node : other) insert(node.key);
+    }
+    HashSet& operator=(const HashSet& other) {
+        if (this != &other) {
+            HashSet copy(other);
+            this->swap(copy);
+        }
+        return *this;
+    }
+    using base::swap;
+
+public:     // 【增、查】
+    // 插入key，返回是否是新插入的（已存在则返回false）
+    bool insert(const Key& key) {
+        size_type old_size = this->_size;
+        this->_insert_node(key);
+        return this->_size != old_size;
+    }
+    // 批量插入keys[0, n)
+    void insert_batch(const Key* keys, size_type n) {
+        this->reserve(this->_size + n);
+        this->_insert_batch(keys, n, [](size_type, Node*) {});
+    }
+    iterator find(const Key& key) const {
+        size_type bucket;
+        Node* node = this->_find_node(key, bucket);
+        return node ? iterator(this, bucket, node) : this->end();
+    }
+    bool contains(const Key& key)    const { return this->_find_node(key) != nullptr; }
+    size_type count(const Key& key)  const { return this->_find_node(key) ? 1 : 0; }
+    // 透明查找：KeyHasher与KeyCompare都声明了is_transparent时，可直接以const char*/StringView等查找，不构造临时Key
+    template <class K, class = typename __TransparentKey<KeyHasher, KeyCompare, K>::type>
+    iterator find(const K& key) const {
+        size_type bucket;
+        Node* node = this->_find_node(key, bucket);
+        return node ? iterator(this, bucket, node) : this->end();
+    }
+    template <class K, class = typename __TransparentKey<KeyHasher, KeyCompare, K>::type>
+    bool contains(const K& key)      const { return this->_find_node(key) != nullptr; }
+    template <class K, class = typename __TransparentKey<KeyHasher, KeyCompare, K>::type>
+    size_type count(const K& key)    const { return this->_find_node(key) ? 1 : 0; }
+    // 批量查找：out[i]即keys[i]是否存在，返回存在的个数
+    size_type contains_batch(const Key* keys, size_type n, bool* out) const {
+        size_type found = 0;
+        this->_find_batch(keys, n, [&](size_type i, Node* node) {
+            out[i] = node != nullptr;
+            found += node != nullptr;
+        });
+        return found;
+    }
+
+public:     // 【删】
+    size_type erase(const Key& key) { return this->_erase_node(key); }
+
+public:     // 【集合运算】返回新集合
+    // 并集：拷贝较大的，再插入较小的
+    HashSet set_union(const HashSet& other) const {
+        const HashSet& large = this->size() >= other.size() ? *this : other;
+        const HashSet& small = this->size() >= other.size() ? other : *this;
+        HashSet result(large);
+        result.update(small);
+        return result;
+    }
+    // 交集：遍历较小的，在较大的里批量查找
+    HashSet set_intersection(const HashSet& other) const {
+        const HashSet& large = this->size() >= other.size() ? *this : other;
+        const HashSet& small = this->size() >= other.size() ? other : *this;
+        HashSet result;
+        result.reserve(small.size());
+        small._probe(large, [&](const Key& key, bool found) { if (found) result.insert(key); });
+        return result;
+    }
+    // 差集（在本集合、不在other中）
+    HashSet set_difference(const HashSet& other) const {
+        HashSet result;
+        if (other.size() < this->size()) {          // other小：整体拷贝再删掉other的键
+            result = *this;
+            result.difference_update(other);
+        }
+        else {
+            result.reserve(this->size());
+            _probe(other, [&](const Key& key, bool found) { if (!found) result.insert(key); });
+        }
+        return result;
+    }
+
+public:     // 【集合运算】原地修改本集合
+    // 并入other的全部键
+    void update(const HashSet& other) {
+        this->reserve(this->size() + other.size());
+        for (const Node& node : other) insert(node.key);
+    }
+    // 只保留也在other中的键
+    void intersection_update(const HashSet& other) {
+        Vector<Key> removed;
+        _probe(other, [&](const Key& key, bool found) { if (!found) removed.push_back(key); });
+        for (const Key& key : removed) erase(key);
+    }
+    // 删掉也在other中的键
+    void difference_update(const HashSet& other) {
+        if (this == &other) { this->clear();  return; }
+        if (other.size() <= this->size()) {         // other小：直接逐个删
+            for (const Node& node : other) erase(node.key);
+            return;
+        }
+        Vector<Key> removed;                        // 本集合小：查出要删的键再删（遍历中不能删）
+        _probe(other, [&](const Key& key, bool found) { if (found) removed.push_back(key); });
+        for (const Key& key : removed) erase(key);
+    }
+    // 是否是other的子集
+    bool issubset(const HashSet& other) const {
+        if (this->size() > other.size()) return false;
+        bool subset = true;
+        _probe(other, [&](const Key&, bool found) { subset = subset && found; });
+        return subset;
+    }
+    bool operator==(const HashSet& other) const { return this->size() == other.size() && issubset(other); }
+    bool operator!=(const HashSet& other) const { return !(*this == other); }
+};
+
+// cout << hash_set;
+template <class Key, class KeyHasher, class KeyCompare, class TableAlloc, class NodeAlloc>
+ostream& operator<<(ostream& out, const HashSet<Key, KeyHasher, KeyCompare, TableAlloc, NodeAlloc>& hash_set) {
+    out << "{ ";
+    for (const auto& node : hash_set) out << node.key << ", ";
+    return out << "}";
+}
+
+
+#endif // __HASH_SET__
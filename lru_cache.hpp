@@ -0,0 +1,293 @@
+/* lru_cache.hpp
+ * 【LRU缓存】容量有限的哈希映射，满了就淘汰最久未使用的条目
+ * 基于hash_map.hpp的__HashTable<>：节点里直接嵌一条双向链表（侵入式），按最近使用的先后串起全部节点
+ *
+ * (1)命中：一次哈希查找，再把节点摘下挂到链表头，全是O(1)的指针改写，没有额外的分配/查找
+ * (2)插入：新节点挂到链表头；总开销超过容量时从链表尾（最久未使用）逐个淘汰，淘汰前调用回调
+ * (3)容量既可以按条目数（每个条目开销为1），也可以按调用者给出的开销（如字节数）计算
+ * (4)树化/拆树会把节点移动构造到新地址，通过重载__hash_node_moved()修补链表邻居的指针
+ *
+ * ShardedLRUCache<>：按哈希值分成若干个各带一把锁的LRUCache<>，供多线程使用
+ */
+#ifndef __LRU_CACHE__
+#define __LRU_CACHE__
+#include <iostream>
+#include <functional>   // function<>
+#include <mutex>        // mutex, lock_guard<>
+#include <new>          // placement new
+#include "alloc.hpp"
+#include "utils.hpp"
+#include "hash_map.hpp"
+using namespace std;
+
+
+// 最近使用链表的链接部分【LRUCache<>里的表头是只有链接部分的哨兵，链表首尾相接】
+struct __LRULink {
+    __LRULink*  prev;
+    __LRULink*  next;
+};
+
+// LRU缓存的链表节点【先继承链接部分，哈希表需要的key、right等照旧】
+template <class Key, class Value>
+struct __LRUCacheNode: __LRULink {
+    Key                             key;
+    Value                           value;
+    __LRUCacheNode<Key, Value>*     right;
+    size_t                          cost;
+};
+
+// LRU缓存的树节点
+template <class Key, class Value>
+struct __LRUCacheTreeNode: __LRUCacheNode<Key, Value> {
+    __LRUCacheTreeNode<Key, Value>* left;
+    bool                            color;
+};
+
+// 节点挪到新地址后，让最近使用链表上的邻居改指新地址
+// 【刚插入、还没挂上链表的节点也可能随整个桶树化，此时prev为nullptr】
+template <class Key, class Value>
+inline void __hash_node_moved(__LRUCacheNode<Key, Value>*, __LRUCacheNode<Key, Value>* to) {
+    if (!to->prev) return;
+    to->prev->next = to;
+    to->next->prev = to;
+}
+
+
+// """LRU缓存"""
+template <class Key,
+          class Value,
+          class KeyHasher   = HashCode<Key>,
+          class KeyCompare  = Compare<Key>,
+          class TableAlloc  = FirstAlloc,
+          class NodeAlloc   = SecondAlloc>
+class LRUCache: public __HashTable<__LRUCacheNode<Key, Value>, __LRUCacheTreeNode<Key, Value>,
+                                   Key, KeyHasher, KeyCompare, TableAlloc, NodeAlloc> {
+
+public:     // 【类型定义】
+    typedef size_t              size_type;
+    typedef __LRUCacheNode<Key, Value>      Node;
+    typedef __LRUCacheTreeNode<Key, Value>  TreeNode;
+    typedef __HashTable<Node, TreeNode, Key, KeyHasher, KeyCompare, TableAlloc, NodeAlloc> base;
+    typedef function<void(const Key&, Value&)>  evict_callback;   // 淘汰回调，参数为被淘汰的键、值
+
+private:    // 【成员变量】
+    __LRULink       _head;          // 哨兵：_head.next为最近使用的，_head.prev为最久未使用的
+    size_type       _capacity;      // 开销上限
+    size_type       _total_cost;    // 当前开销之和
+    evict_callback  _on_evict;
+
+private:    // 【最近使用链表】
+    void _unlink(__LRULink* link) {
+        link->prev->next = link->next;
+        link->next->prev = link->prev;
+    }
+    void _push_front(__LRULink* link) {
+        link->prev = &_head;
+        link->next = _head.next;
+        _head.next->prev = link;
+        _head.next = link;
+    }
+    void _move_to_front(__LRULink* link) {
+        if (_head.next == link) return;
+        _unlink(link);
+        _push_front(link);
+    }
+    // 淘汰最久未使用的条目，直到总开销不超过容量
+    void _evict() {
+        while (_total_cost > _capacity && _head.prev != &_head) {
+            Node* victim = static_cast<Node*>(_head.prev);
+            if (_on_evict) _on_evict(victim->key, victim->value);
+            _unlink(victim);
+            _total_cost -= victim->cost;
+            this->_erase_node(victim->key);     // 节点直到查找完毕才释放，传其自身的键是安全的
+        }
+    }
+
+public:     // 【构造/析构函数】
+    // capacity即开销上限；每次put()都用缺省开销1时，就是最多缓存capacity个条目
+    explicit LRUCache(size_type capacity): _capacity(capacity), _total_cost(0)
+        { _head.prev = _head.next = &_head; }
+private:
+    LRUCache(const LRUCache&);
+    LRUCache& operator=(const LRUCache&);
+
+public:     // 【Basic Accessor】
+    size_type capacity()   const { return _capacity; }
+    size_type total_cost() const { return _total_cost; }
+    void set_eviction_callback(const evict_callback& on_evict) { _on_evict = on_evict; }
+    // 调整容量，变小时立即淘汰多出的条目
+    void set_capacity(size_type capacity) {
+        _capacity = capacity;
+        _evict();
+    }
+
+public:     // 【增、改】
+    // 插入或覆盖，并标记为最近使用；超出容量则从最久未使用的开始淘汰
+    // 【单个条目的开销就超过容量时，它自己最后也会被淘汰，即不缓存】
+    void put(const Key& key, const Value& value, size_type cost = 1) {
+        size_type old_size = this->_size;
+        Node* node = this->_insert_node(key);
+        if (this->_size != old_size) _push_front(node);
+        else {
+            _total_cost -= node->cost;
+            _move_to_front(node);
+        }
+        node->value = value;
+        node->cost = cost;
+        _total_cost += cost;
+        _evict();
+    }
+
+public:     // 【查】
+    // 命中则标记为最近使用并返回值的指针，否则返回nullptr【指针在下次put()/erase()前有效】
+    Value* get(const Key& key) {
+        Node* node = this->_find_node(key);
+        if (!node) return nullptr;
+        _move_to_front(node);
+        return &node->value;
+    }
+    // 只查看，不改变最近使用的顺序
+    const Value* peek(const Key& key) const {
+        const Node* node = this->_find_node(key);
+        return node ? &node->value : nullptr;
+    }
+    bool contains(const Key& key) const { return this->_find_node(key) != nullptr; }
+    // 从最近使用到最久未使用依次调用func(key, value)
+    template <class Function>
+    void for_each(Function func) const {
+        for (const __LRULink* link = _head.next; link != &_head; link = link->next)
+            func(static_cast<const Node*>(link)->key, static_cast<const Node*>(link)->value);
+    }
+
+public:     // 【删】不调用淘汰回调
+    size_type erase(const Key& key) {
+        Node* node = this->_find_node(key);
+        if (!node) return 0;
+        _unlink(node);
+        _total_cost -= node->cost;
+        return this->_erase_node(key);
+    }
+    void clear() {
+        base::clear();
+        _head.prev = _head.next = &_head;
+        _total_cost = 0;
+    }
+};
+
+// cout << lru_cache;【从最近使用到最久未使用】
+template <class Key, class Value, class KeyHasher, class KeyCompare, class TableAlloc, class NodeAlloc>
+ostream& operator<<(ostream& out, const LRUCache<Key, Value, KeyHasher, KeyCompare, TableAlloc, NodeAlloc>& cache) {
+    out << "[ ";
+    cache.for_each([&out](const Key& key, const Value& value) { out << key << ": " << value << ", "; });
+    return out << "]";
+}
+
+
+// """分片LRU缓存"""
+// 按哈希值把键分到n_shards个分片，每个分片是一个带锁的LRUCache<>，容量平分；不同分片的操作互不阻塞
+// 淘汰只在分片内进行，故整体是近似的LRU
+// 【二级内存分配器不是线程安全的，分片一律用一级内存分配器】
+template <class Key,
+          class Value,
+          class KeyHasher   = HashCode<Key>,
+          class KeyCompare  = Compare<Key> >
+class ShardedLRUCache {
+
+public:     // 【类型定义】
+    typedef size_t              size_type;
+    typedef LRUCache<Key, Value, KeyHasher, KeyCompare, FirstAlloc, FirstAlloc> cache_type;
+    typedef typename cache_type::evict_callback evict_callback;
+    static const size_type default_shards = 16;
+
+private:    // 【分片】
+    struct Shard {
+        mutex       lock;
+        cache_type  cache;
+        explicit Shard(size_type capacity): cache(capacity) {}
+    };
+
+private:    // 【成员变量】
+    KeyHasher   _hasher;
+    Shard*      _shards;
+    size_type   _n_shards;
+
+private:
+    // 取混合后哈希值的高位选分片，与分片内部按 hash % 表长 选桶互不相关
+    Shard& _shard_of(const Key& key) {
+        uint64_t h = (uint64_t)_hasher(key) * 0x9E3779B97F4A7C15ULL;
+        return _shards[(size_type)(h >> 32) % _n_shards];
+    }
+    ShardedLRUCache(const ShardedLRUCache&);
+    ShardedLRUCache& operator=(const ShardedLRUCache&);
+
+public:     // 【构造/析构函数】
+    explicit ShardedLRUCache(size_type capacity, size_type n_shards = default_shards):
+        _n_shards(n_shards ? n_shards : 1) {
+        _shards = Allocator<Shard>::allocate(_n_shards);
+        for (size_type i=0; i<_n_shards; ++i)
+            new (_shards+i) Shard(capacity/_n_shards + (i < capacity%_n_shards));
+    }
+    ~ShardedLRUCache() {
+        for (size_type i=0; i<_n_shards; ++i) _shards[i].~Shard();
+        Allocator<Shard>::deallocate(_shards);
+    }
+
+public:     // 【Basic Accessor】
+    size_type size() {
+        size_type n = 0;
+        for (size_type i=0; i<_n_shards; ++i) {
+            lock_guard<mutex> guard(_shards[i].lock);
+            n += _shards[i].cache.size();
+        }
+        return n;
+    }
+    size_type total_cost() {
+        size_type n = 0;
+        for (size_type i=0; i<_n_shards; ++i) {
+            lock_guard<mutex> guard(_shards[i].lock);
+            n += _shards[i].cache.total_cost();
+        }
+        return n;
+    }
+    // 回调在分片锁内执行，不要在回调里再访问本缓存
+    void set_eviction_callback(const evict_callback& on_evict) {
+        for (size_type i=0; i<_n_shards; ++i) {
+            lock_guard<mutex> guard(_shards[i].lock);
+            _shards[i].cache.set_eviction_callback(on_evict);
+        }
+    }
+
+public:     // 【增、改、查、删】
+    void put(const Key& key, const Value& value, size_type cost = 1) {
+        Shard& shard = _shard_of(key);
+        lock_guard<mutex> guard(shard.lock);
+        shard.cache.put(key, value, cost);
+    }
+    // 命中则把值拷贝到value并返回true【锁外不能持有指向条目的指针】
+    bool get(const Key& key, Value& value) {
+        Shard& shard = _shard_of(key);
+        lock_guard<mutex> guard(shard.lock);
+        Value* found = shard.cache.get(key);
+        if (found) value = *found;
+        return found != nullptr;
+    }
+    bool contains(const Key& key) {
+        Shard& shard = _shard_of(key);
+        lock_guard<mutex> guard(shard.lock);
+        return shard.cache.contains(key);
+    }
+    size_type erase(const Key& key) {
+        Shard& shard = _shard_of(key);
+        lock_guard<mutex> guard(shard.lock);
+        return shard.cache.erase(key);
+    }
+    void clear() {
+        for (size_type i=0; i<_n_shards; ++i) {
+            lock_guard<mutex> guard(_shards[i].lock);
+            _shards[i].cache.clear();
+        }
+    }
+};
+
+
+#endif // __LRU_CACHE__
@@ -158,6 +158,54 @@ public:     // 【删】
 };
 
 
+// """流式前K大/小 TopK<>"""
+// 以PriorityQueue<>作为“反向”的堆：堆顶是已保留的K个元素中优先级最低的那个（门槛），
+// 新元素比门槛更优先时replace()堆顶即可 —— 每个元素O(logK)时间，总共O(K)空间，可处理无界的数据流
+// 【PrioritySuperior = Greater<Type>即前K大，Less<Type>即前K小】
+template <class PrioritySuperior>
+struct __InverseSuperior {
+    PrioritySuperior superior;
+    template <class Type>
+    bool operator()(const Type& a, const Type& b) const { return superior(b, a); }
+};
+
+template < class Type, class PrioritySuperior = Greater<Type>, class Alloc = FirstAlloc >
+class TopK {
+
+public:     // 【类型定义】
+    typedef Type        value_type;
+    typedef size_t      size_type;
+
+private:    // 【成员变量】
+    PriorityQueue<Type, __InverseSuperior<PrioritySuperior>, Alloc> _heap;
+    size_type           _k;
+    PrioritySuperior    _superior;
+
+public:     // 【构造函数】
+    TopK(size_type k): _heap(k), _k(k) {}
+
+public:     // 【查】
+    size_type size()        const { return _heap.size(); }
+    size_type k()           const { return _k; }
+    bool empty()            const { return _heap.empty(); }
+    bool full()             const { return _heap.size() == _k; }
+    const Type& threshold() const { return _heap.top(); }   // 已保留元素中优先级最低的一个，即目前的“第K大/小”
+
+public:     // 【增】
+    // 处理数据流中的一个元素，返回其是否（暂时）入选
+    bool push(const Type& item) {
+        if (_heap.size() < _k) { _heap.push(item); return true; }
+        if (_k == 0 || !_superior(item, _heap.top())) return false;
+        _heap.replace(item);
+        return true;
+    }
+
+public:     // 【删】
+    // 按优先级由低到高依次弹出已保留的元素
+    Type pop() { return _heap.pop(); }
+};
+
+
 #endif // __PRIORITY_QUEUE__
 
 
@@ -1,68 +1,749 @@
+/* rb_tree.hpp
+ * 【红黑树】TreeMap<> TreeSet<> 共同的底层结构，增/删/查都是最坏O(logn)
+ * STL当中 <stl_tree.h> 部分内容的简化版
+ *
+ * 结构（与SGI STL的_Rb_tree一样）：
+ * (1)每个节点有父指针，插入/删除自底向上修复，无需递归
+ * (2)一个不存数据的头节点_header：_header.parent即树根，_header.left/_header.right即最小/最大节点，
+ *    树根的parent指回_header；_header本身即end()，于是begin()/end()都是O(1)
+ * (3)迭代器沿父指针中序前进/后退，单步最坏O(logn)，遍历整棵树均摊O(1)
+ * (4)_header涂成红色、树根总是黑色，--end()时据此区分_header与树根
+ * (5)顺序统计：每个节点记录子树的节点数size，插入/删除时沿路径增减、旋转时重算两个节点，
+ *    于是排名rank()、第k小select()、区间计数都是O(logn)；代价是每个节点多一个字
+ * (6)批量操作（参考Blelloch等的“Just Join for Parallel Ordered Sets”）：以按黑高拼接的_join()为原语，
+ *    拆分/拼接O(logn)，并集/差集O(mlog(n/m+1))，全程挪动原有节点，不拷贝、不重新分配；
+ *    有序序列建树则逐个构造节点后直接连成平衡树，O(n)
+ */
 #ifndef __RB_TREE__
 #define __RB_TREE__
 #include <initializer_list>
+#include <new>          // placement new
+#include <utility>      // swap()
 #include "alloc.hpp"
 #include "traits.hpp"
 #include "utils.hpp"
+using namespace std;
 
 
 // """红黑树节点"""
 // 【红黑树节点基类】
 struct __TreeNodeBase {
-    __TreeNodeBase *left, *right;
+    __TreeNodeBase *left, *right, *parent;
+    size_t size;        // 以本节点为根的子树的节点数
     bool color;
 };
 // 【只包含键，用于TreeSet】
-template < class Key, class Alloc = SecondAlloc >
-struct __TreeSetNode: __TreeNodeBase { 
+template <class Key>
+struct __TreeSetNode: __TreeNodeBase {
     Key key;
-    void* operator new(size_t nbytes) { return Alloc::allocate(nbytes); }
-    void operator delete(void* ptr)   { Alloc::deallocate(ptr); }
 };
 // 【包含键-值，用于TreeMap】
-template < class Key, class Value, class Alloc = SecondAlloc >
-struct __TreeMapNode: __TreeNodeBase { 
-    Key key; 
-    Value value; 
-    void* operator new(size_t nbytes) { return Alloc::allocate(nbytes); }
-    void operator delete(void* ptr)   { Alloc::deallocate(ptr); }
+template <class Key, class Value>
+struct __TreeMapNode: __TreeNodeBase {
+    Key key;
+    Value value;
+};
+
+
+// """中序的前驱/后继"""
+namespace mystl {
+    inline __TreeNodeBase* __tree_minimum(__TreeNodeBase* node) {
+        while (node->left) node = node->left;
+        return node;
+    }
+    inline __TreeNodeBase* __tree_maximum(__TreeNodeBase* node) {
+        while (node->right) node = node->right;
+        return node;
+    }
+    // 后继：有右子树则是右子树的最小节点，否则向上找到第一个“从左边上来”的祖先
+    inline __TreeNodeBase* __tree_increment(__TreeNodeBase* node) {
+        if (node->right) return __tree_minimum(node->right);
+        __TreeNodeBase* parent = node->parent;
+        while (node == parent->right) { node = parent;  parent = parent->parent; }
+        // 树根没有右孩子、从最大节点往上走时，node停在_header、parent停在树根，此时node即end()
+        return node->right != parent ? parent : node;
+    }
+    // 前驱：end()（红色的_header，其祖父即自身）的前驱是最大节点
+    inline __TreeNodeBase* __tree_decrement(__TreeNodeBase* node) {
+        if (node->color && node->parent->parent == node) return node->right;
+        if (node->left) return __tree_maximum(node->left);
+        __TreeNodeBase* parent = node->parent;
+        while (node == parent->left) { node = parent;  parent = parent->parent; }
+        return parent;
+    }
+};
+
+
+// 迭代器【it->key，it->value】
+template <class NodeType>
+struct __RBTreeIterator {
+    // 类型定义
+    typedef BidirectIteratorTag             iterator_category;  // 双向迭代器
+    typedef NodeType                        value_type;
+    typedef NodeType*                       pointer;
+    typedef NodeType&                       reference;
+    typedef size_t                          size_type;
+    typedef ptrdiff_t                       difference_type;
+    typedef __RBTreeIterator<NodeType>      iterator;
+    // 成员变量
+    __TreeNodeBase* cur;        // 当前节点，_header即end()
+    // 构造函数
+    __RBTreeIterator(): cur(nullptr) {}
+    explicit __RBTreeIterator(__TreeNodeBase* node): cur(node) {}
+    // *self, ->self, self==other, self!=other
+    NodeType& operator*()  const { return *static_cast<NodeType*>(cur); }
+    NodeType* operator->() const { return static_cast<NodeType*>(cur); }
+    bool operator==(const iterator& other) const { return cur == other.cur; }
+    bool operator!=(const iterator& other) const { return cur != other.cur; }
+    // ++self, self++, --self, self--
+    iterator& operator++()      { cur = mystl::__tree_increment(cur);  return *this; }
+    iterator operator++(int)    { iterator tmp(*this);  cur = mystl::__tree_increment(cur);  return tmp; }
+    iterator& operator--()      { cur = mystl::__tree_decrement(cur);  return *this; }
+    iterator operator--(int)    { iterator tmp(*this);  cur = mystl::__tree_decrement(cur);  return tmp; }
 };
 
 
 // """红黑树"""
-template < class NodeType, class Key, class KeyCompare >
-struct __RBTree {
-    // 【类型定义】
+// NodeType需继承__TreeNodeBase并有key成员
+template <class NodeType, class Key, class KeyCompare, class Alloc = SecondAlloc>
+class __RBTree {
+
+public:     // 【类型定义】
+    typedef size_t                          size_type;
+    typedef ptrdiff_t                       difference_type;
+    typedef NodeType                        node_type;
+    typedef __RBTreeIterator<NodeType>      iterator;
+    typedef Allocator<NodeType, Alloc>      node_allocator;
     static const bool red   = true;
     static const bool black = false;
-    
-    // 【成员变量】
-    KeyCompare  _compare;
-    NodeType*   _root;
-    size_t      _count;
 
-    // 【构造/析构函数】
-    __RBTree(): _root(nullptr), _count(0) {}
-    ~__RBTree() { _clear(_root); _count=0; }
+protected:  // 【成员变量】
+    KeyCompare      _compare;   // 键的三路比较器
+    __TreeNodeBase  _header;    // parent为树根，left/right为最小/最大节点
+    size_type       _count;
+
+protected:  // 【构造/析构节点】
+    static NodeType* _make_node(const Key& key) {
+        NodeType* node = node_allocator::allocate();
+        new (node) NodeType();
+        node->key = key;
+        return node;
+    }
+    static NodeType* _clone_node(const __TreeNodeBase* src) {
+        NodeType* node = node_allocator::allocate();
+        new (node) NodeType(*static_cast<const NodeType*>(src));
+        node->left = node->right = nullptr;
+        return node;
+    }
+    static void _destroy_node(__TreeNodeBase* node) {
+        static_cast<NodeType*>(node)->~NodeType();
+        node_allocator::deallocate(static_cast<NodeType*>(node));
+    }
+    static void _clear(__TreeNodeBase* opnode) {
+        while (opnode) {        // 右子树递归、左子树迭代，递归深度即树高
+            _clear(opnode->right);
+            __TreeNodeBase* left = opnode->left;
+            _destroy_node(opnode);
+            opnode = left;
+        }
+    }
+    // 拷贝以src为根的子树，新子树根的父节点为parent
+    static __TreeNodeBase* _copy(const __TreeNodeBase* src, __TreeNodeBase* parent) {
+        __TreeNodeBase* top = _clone_node(src);
+        top->parent = parent;
+        if (src->right) top->right = _copy(src->right, top);
+        for (parent = top, src = src->left; src; parent = parent->left, src = src->left) {
+            __TreeNodeBase* node = _clone_node(src);
+            parent->left = node;
+            node->parent = parent;
+            if (src->right) node->right = _copy(src->right, node);
+        }
+        return top;
+    }
+    void _reset() {
+        _header.parent = nullptr;
+        _header.left = _header.right = &_header;
+        _count = 0;
+    }
+
+protected:  // 【辅助函数】
+    __TreeNodeBase* _root() const { return _header.parent; }
+    __TreeNodeBase* _end()  const { return const_cast<__TreeNodeBase*>(&_header); }
+    static const Key& _key(const __TreeNodeBase* node) { return static_cast<const NodeType*>(node)->key; }
+    static bool _is_red(const __TreeNodeBase* node) { return node && node->color == red; }
+    static size_type _size(const __TreeNodeBase* node) { return node ? node->size : 0; }
+
+protected:  // 【左/右旋转】
+    // 左旋：x的右孩子y升为子树根，x成为y的左孩子，y原来的左子树改挂为x的右子树；右旋与之对称
+    // 子树整体的节点数不变：y接过x原来的size，x按新的两个孩子重算
+    // root即树根（x是树根时改为y），可以是_header.parent，也可以是拆分/拼接中一棵独立子树的根
+    static void _left_rotate(__TreeNodeBase* x, __TreeNodeBase*& root) {
+        __TreeNodeBase* y = x->right;
+        x->right = y->left;
+        if (y->left) y->left->parent = x;
+        y->parent = x->parent;
+        if (x == root) root = y;
+        else if (x == x->parent->left) x->parent->left = y;
+        else x->parent->right = y;
+        y->left = x;
+        x->parent = y;
+        y->size = x->size;
+        x->size = _size(x->left) + _size(x->right) + 1;
+    }
+    static void _right_rotate(__TreeNodeBase* x, __TreeNodeBase*& root) {
+        __TreeNodeBase* y = x->left;
+        x->left = y->right;
+        if (y->right) y->right->parent = x;
+        y->parent = x->parent;
+        if (x == root) root = y;
+        else if (x == x->parent->right) x->parent->right = y;
+        else x->parent->left = y;
+        y->right = x;
+        x->parent = y;
+        y->size = x->size;
+        x->size = _size(x->left) + _size(x->right) + 1;
+    }
+    void _left_rotate(__TreeNodeBase* x)  { _left_rotate(x, _header.parent); }
+    void _right_rotate(__TreeNodeBase* x) { _right_rotate(x, _header.parent); }
+
+protected:  // 【增】
+    // 新插入的红节点x与红色父节点冲突时，自底向上修复；返回树根是否由红涂黑（即黑高是否加一）
+    static bool _insert_fixup(__TreeNodeBase* x, __TreeNodeBase*& root) {
+        while (x != root && x->parent->color == red) {
+            __TreeNodeBase* xp = x->parent;
+            __TreeNodeBase* xpp = xp->parent;
+            if (xp == xpp->left) {
+                __TreeNodeBase* uncle = xpp->right;
+                if (_is_red(uncle)) {               // 叔叔红：父、叔涂黑，祖父涂红，问题上移两层
+                    xp->color = uncle->color = black;
+                    xpp->color = red;
+                    x = xpp;
+                }
+                else {                              // 叔叔黑：至多两次旋转即可结束
+                    if (x == xp->right) { x = xp;  _left_rotate(x, root);  xp = x->parent; }
+                    xp->color = black;
+                    xpp->color = red;
+                    _right_rotate(xpp, root);
+                }
+            }
+            else {
+                __TreeNodeBase* uncle = xpp->left;
+                if (_is_red(uncle)) {
+                    xp->color = uncle->color = black;
+                    xpp->color = red;
+                    x = xpp;
+                }
+                else {
+                    if (x == xp->left) { x = xp;  _right_rotate(x, root);  xp = x->parent; }
+                    xp->color = black;
+                    xpp->color = red;
+                    _left_rotate(xpp, root);
+                }
+            }
+        }
+        bool grown = root->color == red;
+        root->color = black;
+        return grown;
+    }
+    // 把新节点node挂为parent的左/右孩子并修复
+    void _link_node(__TreeNodeBase* node, __TreeNodeBase* parent, bool to_left) {
+        node->parent = parent;
+        node->left = node->right = nullptr;
+        node->size = 1;
+        node->color = red;
+        for (__TreeNodeBase* p = parent; p != &_header; p = p->parent) ++p->size;
+        if (parent == &_header) {
+            _header.parent = _header.left = _header.right = node;
+        }
+        else if (to_left) {
+            parent->left = node;
+            if (parent == _header.left) _header.left = node;
+        }
+        else {
+            parent->right = node;
+            if (parent == _header.right) _header.right = node;
+        }
+        _insert_fixup(node, _header.parent);
+        ++_count;
+    }
+    // 返回键为key的节点，不存在则插入一个（值初始化的）新节点；inserted即是否新插入
+    NodeType* _insert_node(const Key& key, bool& inserted) {
+        __TreeNodeBase* parent = &_header;
+        __TreeNodeBase* cur = _header.parent;
+        int cmp = 0;
+        while (cur) {
+            cmp = _compare(key, _key(cur));
+            if (cmp == 0) { inserted = false;  return static_cast<NodeType*>(cur); }
+            parent = cur;
+            cur = cmp < 0 ? cur->left : cur->right;
+        }
+        NodeType* node = _make_node(key);
+        _link_node(node, parent, cmp < 0);
+        inserted = true;
+        return node;
+    }
+    NodeType* _insert_node(const Key& key) { bool inserted;  return _insert_node(key, inserted); }
+
+protected:  // 【删】
+    // 摘下节点z并释放，自底向上修复（同SGI STL的_Rb_tree_rebalance_for_erase）
+    void _erase_node(__TreeNodeBase* z) {
+        __TreeNodeBase* y = z;              // 实际从树上摘掉的位置
+        __TreeNodeBase* x = nullptr;        // 顶替y的孩子（可能为空）
+        __TreeNodeBase* x_parent = nullptr;
+        if (!y->left) x = y->right;
+        else if (!y->right) x = y->left;
+        else { y = mystl::__tree_minimum(y->right);  x = y->right; }
+        for (__TreeNodeBase* p = y->parent; p != &_header; p = p->parent) --p->size;    // y的祖先都少一个节点
+        if (y != z) {                       // z有两个孩子：让后继y顶替z的位置（挪节点而非拷贝键值，迭代器不失效）
+            z->left->parent = y;
+            y->left = z->left;
+            if (y != z->right) {
+                x_parent = y->parent;
+                if (x) x->parent = y->parent;
+                y->parent->left = x;
+                y->right = z->right;
+                z->right->parent = y;
+            }
+            else x_parent = y;
+            if (_header.parent == z) _header.parent = y;
+            else if (z->parent->left == z) z->parent->left = y;
+            else z->parent->right = y;
+            y->parent = z->parent;
+            y->size = z->size;
+            std::swap(y->color, z->color);  // 此后z的颜色即被摘掉的那个位置的颜色
+        }
+        else {                              // z至多一个孩子：孩子x直接顶替
+            x_parent = z->parent;
+            if (x) x->parent = z->parent;
+            if (_header.parent == z) _header.parent = x;
+            else if (z->parent->left == z) z->parent->left = x;
+            else z->parent->right = x;
+            if (_header.left == z)
+                _header.left = z->right ? mystl::__tree_minimum(x) : z->parent;     // 树删空时即_header
+            if (_header.right == z)
+                _header.right = z->left ? mystl::__tree_maximum(x) : z->parent;
+        }
+        if (z->color == black) {            // 摘掉黑色的位置后，x所在路径少了一个黑节点
+            while (x != _header.parent && !_is_red(x)) {
+                if (x == x_parent->left) {
+                    __TreeNodeBase* w = x_parent->right;
+                    if (_is_red(w)) {
+                        w->color = black;
+                        x_parent->color = red;
+                        _left_rotate(x_parent);
+                        w = x_parent->right;
+                    }
+                    if (!_is_red(w->left) && !_is_red(w->right)) {
+                        w->color = red;
+                        x = x_parent;
+                        x_parent = x_parent->parent;
+                    }
+                    else {
+                        if (!_is_red(w->right)) {
+                            w->left->color = black;
+                            w->color = red;
+                            _right_rotate(w);
+                            w = x_parent->right;
+                        }
+                        w->color = x_parent->color;
+                        x_parent->color = black;
+                        if (w->right) w->right->color = black;
+                        _left_rotate(x_parent);
+                        break;
+                    }
+                }
+                else {
+                    __TreeNodeBase* w = x_parent->left;
+                    if (_is_red(w)) {
+                        w->color = black;
+                        x_parent->color = red;
+                        _right_rotate(x_parent);
+                        w = x_parent->left;
+                    }
+                    if (!_is_red(w->right) && !_is_red(w->left)) {
+                        w->color = red;
+                        x = x_parent;
+                        x_parent = x_parent->parent;
+                    }
+                    else {
+                        if (!_is_red(w->left)) {
+                            w->right->color = black;
+                            w->color = red;
+                            _left_rotate(w);
+                            w = x_parent->left;
+                        }
+                        w->color = x_parent->color;
+                        x_parent->color = black;
+                        if (w->left) w->left->color = black;
+                        _right_rotate(x_parent);
+                        break;
+                    }
+                }
+            }
+            if (x) x->color = black;
+        }
+        _destroy_node(z);
+        --_count;
+    }
+    size_type _erase_key(const Key& key) {
+        __TreeNodeBase* node = _find_node(key);
+        if (!node) return 0;
+        _erase_node(node);
+        return 1;
+    }
+
+protected:  // 【查】
+    template <class K>
+    NodeType* _find_node(const K& key) const {
+        __TreeNodeBase* cur = _header.parent;
+        while (cur) {
+            int cmp = _compare(key, _key(cur));
+            if (cmp == 0) return static_cast<NodeType*>(cur);
+            cur = cmp < 0 ? cur->left : cur->right;
+        }
+        return nullptr;
+    }
+    // 第一个键>=key的节点，没有则为_header
+    template <class K>
+    __TreeNodeBase* _lower_bound(const K& key) const {
+        __TreeNodeBase* result = _end();
+        for (__TreeNodeBase* cur = _header.parent; cur; )
+            if (_compare(_key(cur), key) < 0) cur = cur->right;
+            else { result = cur;  cur = cur->left; }
+        return result;
+    }
+    // 第一个键>key的节点，没有则为_header
+    template <class K>
+    __TreeNodeBase* _upper_bound(const K& key) const {
+        __TreeNodeBase* result = _end();
+        for (__TreeNodeBase* cur = _header.parent; cur; )
+            if (_compare(key, _key(cur)) < 0) { result = cur;  cur = cur->left; }
+            else cur = cur->right;
+        return result;
+    }
+
+protected:  // 【批量查找】
+    // 逐个查找时每下一层都要等一次cache miss，而下一层的地址取决于这一层的比较结果，没法像哈希表那样提前预取
+    // 改为一组__batch_group个键交错下降：每一轮组内每个键各下一层、并预取它的下一个节点，组内的cache miss同时在路上
+    static const size_type __batch_group = 8;
+    // 对keys[0, n)逐个调用visit(i, node)，node为键keys[i]的节点，不存在则为nullptr
+    template <class KeyArray, class Visitor>
+    void _find_batch(KeyArray keys, size_type n, Visitor visit) const {
+        const size_type G = __batch_group;
+        __TreeNodeBase* cur[G];                     // 组内各键当前所在的节点，nullptr即已查完
+        NodeType* found[G];
+        for (size_type base=0; base<n; base+=G) {
+            size_type g = n-base < G ? n-base : G;
+            for (size_type j=0; j<g; ++j) { cur[j] = _header.parent;  found[j] = nullptr; }
+            for (size_type live = _header.parent ? g : 0; live > 0; ) {
+                for (size_type j=0; j<g; ++j) {
+                    __TreeNodeBase* node = cur[j];
+                    if (!node) continue;
+                    int cmp = _compare(keys[base+j], _key(node));
+                    if (cmp == 0) { found[j] = static_cast<NodeType*>(node);  node = nullptr; }
+                    else          { node = cmp < 0 ? node->left : node->right;  __prefetch(node); }
+                    if (!(cur[j] = node)) --live;
+                }
+            }
+            for (size_type j=0; j<g; ++j) visit(base+j, found[j]);
+        }
+    }
+
+protected:  // 【顺序统计】
+    // 键<key的节点数（即lower_bound(key)的下标）
+    template <class K>
+    size_type _rank(const K& key) const {
+        size_type rank = 0;
+        for (__TreeNodeBase* cur = _header.parent; cur; )
+            if (_compare(_key(cur), key) < 0) { rank += _size(cur->left) + 1;  cur = cur->right; }
+            else cur = cur->left;
+        return rank;
+    }
+    // 键<=key的节点数（即upper_bound(key)的下标）
+    template <class K>
+    size_type _rank_upper(const K& key) const {
+        size_type rank = 0;
+        for (__TreeNodeBase* cur = _header.parent; cur; )
+            if (_compare(key, _key(cur)) < 0) cur = cur->left;
+            else { rank += _size(cur->left) + 1;  cur = cur->right; }
+        return rank;
+    }
+    // 第k小（从0数起）的节点，k>=_count则为_header
+    __TreeNodeBase* _select(size_type k) const {
+        if (k >= _count) return _end();
+        __TreeNodeBase* cur = _header.parent;
+        while (true) {
+            size_type left_size = _size(cur->left);
+            if (k < left_size) cur = cur->left;
+            else if (k == left_size) return cur;
+            else { k -= left_size + 1;  cur = cur->right; }
+        }
+    }
+    // 键在[lo, hi]内的节点数
+    template <class K>
+    size_type _count_range(const K& lo, const K& hi) const {
+        if (_compare(hi, lo) < 0) return 0;
+        return _rank_upper(hi) - _rank(lo);
+    }
+
+protected:  // 【有序序列建树】
+    // 中序依次取元素、每次对半分：除最底层外各层都是满的，最底层（深度red_depth）涂红、其余涂黑，即是合法的红黑树
+    template <class Iterator, class Make>
+    static __TreeNodeBase* _build(Iterator& first, size_type n, size_type depth, size_type red_depth, Make& make) {
+        if (n == 0) return nullptr;
+        size_type left_n = (n - 1) / 2;
+        __TreeNodeBase* left = _build(first, left_n, depth + 1, red_depth, make);
+        __TreeNodeBase* node = make(*first);
+        ++first;
+        node->left = left;
+        node->right = _build(first, n - 1 - left_n, depth + 1, red_depth, make);
+        if (node->left) node->left->parent = node;
+        if (node->right) node->right->parent = node;
+        node->size = n;
+        node->color = depth == red_depth ? red : black;
+        return node;
+    }
+    // 以[first, last)重建本树：key_of(item)取键，make(item)构造节点；序列不是严格升序则不动本树，返回false
+    template <class Iterator, class KeyOf, class Make>
+    bool _assign_sorted(Iterator first, Iterator last, KeyOf key_of, Make make) {
+        size_type n = 0;
+        for (Iterator cur = first, prev = first; cur != last; prev = cur++, ++n)
+            if (n > 0 && _compare(key_of(*prev), key_of(*cur)) >= 0) return false;
+        clear();
+        if (n == 0) return true;
+        size_type red_depth = 0;                    // floor(log2(n+1))：其上各层都是满的
+        while ((size_type(2) << red_depth) <= n + 1) ++red_depth;
+        _Subtree tree = { _build(first, n, 0, red_depth, make), 0 };
+        tree.root->parent = nullptr;
+        _attach(tree);
+        return true;
+    }
 
-    // 【构造/析构节点】
-    static NodeType* _make_node(const Key& key);
-    static void _destroy_node(NodeType* opnode);
+protected:  // 【拆分/拼接】
+    // 一棵独立的子树：root->parent为空且root为黑，height为其黑高（由根到空叶经过的黑节点数）
+    struct _Subtree {
+        __TreeNodeBase* root;
+        size_type       height;
+    };
+    // 把黑高为height的子树node（可为空）独立出来：红根涂黑，黑高加一
+    static _Subtree _detach(__TreeNodeBase* node, size_type height) {
+        _Subtree tree = { node, height };
+        if (node) {
+            node->parent = nullptr;
+            if (node->color == red) { node->color = black;  ++tree.height; }
+        }
+        return tree;
+    }
+    // 整棵树摘下为一棵独立子树，本树置空
+    _Subtree _take() {
+        _Subtree tree = { _header.parent, 0 };
+        for (__TreeNodeBase* cur = tree.root; cur; cur = cur->left) tree.height += cur->color == black;
+        if (tree.root) tree.root->parent = nullptr;
+        _reset();
+        return tree;
+    }
+    // 以一棵独立子树作本树的全部节点【本树须为空】
+    void _attach(_Subtree tree) {
+        if (!tree.root) return;
+        tree.root->parent = &_header;
+        _header.parent = tree.root;
+        _header.left = mystl::__tree_minimum(tree.root);
+        _header.right = mystl::__tree_maximum(tree.root);
+        _count = tree.root->size;
+    }
+    // 拼接：left的键 < mid的键 < right的键。两棵黑高相同则mid涂黑作根；否则沿较高一棵的右（左）脊
+    // 下到与另一棵黑高相同的黑节点c，红色的mid顶替c、以c与另一棵为两个孩子，再按插入修复。代价O(黑高之差+1)
+    static _Subtree _join(_Subtree left, __TreeNodeBase* mid, _Subtree right) {
+        if (left.height == right.height) {
+            mid->parent = nullptr;
+            mid->left = left.root;
+            mid->right = right.root;
+            if (left.root) left.root->parent = mid;
+            if (right.root) right.root->parent = mid;
+            mid->size = _size(left.root) + _size(right.root) + 1;
+            mid->color = black;
+            _Subtree tree = { mid, left.height + 1 };
+            return tree;
+        }
+        bool go_right = left.height > right.height;
+        _Subtree tree = go_right ? left : right;
+        _Subtree low = go_right ? right : left;
+        __TreeNodeBase* parent = nullptr;
+        __TreeNodeBase* cur = tree.root;
+        for (size_type height = tree.height; cur && (cur->color == red || height > low.height); ) {
+            if (cur->color == black) --height;
+            parent = cur;
+            cur = go_right ? cur->right : cur->left;
+        }
+        mid->parent = parent;
+        (go_right ? parent->right : parent->left) = mid;
+        mid->left = go_right ? cur : low.root;
+        mid->right = go_right ? low.root : cur;
+        if (cur) cur->parent = mid;
+        if (low.root) low.root->parent = mid;
+        mid->size = _size(cur) + _size(low.root) + 1;
+        mid->color = red;
+        for (__TreeNodeBase* p = parent; p; p = p->parent) p->size += _size(low.root) + 1;
+        if (_insert_fixup(mid, tree.root)) ++tree.height;
+        return tree;
+    }
+    // 按key拆成键<key、键>key的两棵，返回键等于key的节点（已摘下，没有则为nullptr）。代价O(logn)
+    template <class K>
+    __TreeNodeBase* _split(_Subtree tree, const K& key, _Subtree& left, _Subtree& right) const {
+        if (!tree.root) { left = right = tree;  return nullptr; }
+        __TreeNodeBase* node = tree.root;
+        _Subtree node_left = _detach(node->left, tree.height - 1);
+        _Subtree node_right = _detach(node->right, tree.height - 1);
+        int cmp = _compare(key, _key(node));
+        if (cmp == 0) { left = node_left;  right = node_right;  return node; }
+        _Subtree middle;
+        __TreeNodeBase* found;
+        if (cmp < 0) {
+            found = _split(node_left, key, left, middle);
+            right = _join(middle, node, node_right);
+        }
+        else {
+            found = _split(node_right, key, middle, right);
+            left = _join(node_left, node, middle);
+        }
+        return found;
+    }
+    // 摘下最大的节点，其余节点留在rest中
+    static __TreeNodeBase* _split_last(_Subtree tree, _Subtree& rest) {
+        __TreeNodeBase* node = tree.root;
+        _Subtree node_left = _detach(node->left, tree.height - 1);
+        _Subtree node_right = _detach(node->right, tree.height - 1);
+        if (!node_right.root) { rest = node_left;  return node; }
+        _Subtree middle;
+        __TreeNodeBase* last = _split_last(node_right, middle);
+        rest = _join(node_left, node, middle);
+        return last;
+    }
+    // 无中间节点的拼接：left的键 < right的键
+    static _Subtree _join2(_Subtree left, _Subtree right) {
+        if (!left.root) return right;
+        if (!right.root) return left;
+        _Subtree rest;
+        __TreeNodeBase* last = _split_last(left, rest);
+        return _join(rest, last, right);
+    }
+    // 并集：以a的根拆分b，左右两半分别递归，再以a的根拼回；键相同时留下b的节点
+    _Subtree _union(_Subtree a, _Subtree b) {
+        if (!a.root) return b;
+        if (!b.root) return a;
+        __TreeNodeBase* node = a.root;
+        _Subtree a_left = _detach(node->left, a.height - 1);
+        _Subtree a_right = _detach(node->right, a.height - 1);
+        _Subtree b_left, b_right;
+        __TreeNodeBase* found = _split(b, _key(node), b_left, b_right);
+        if (found) { _destroy_node(node);  node = found; }
+        _Subtree left = _union(a_left, b_left);
+        _Subtree right = _union(a_right, b_right);
+        return _join(left, node, right);
+    }
+    // 差集：以b（只读）的根拆分a，删掉相同的键，左右两半分别递归后拼回
+    _Subtree _difference(_Subtree a, const __TreeNodeBase* b) {
+        if (!a.root || !b) return a;
+        _Subtree a_left, a_right;
+        __TreeNodeBase* found = _split(a, _key(b), a_left, a_right);
+        if (found) _destroy_node(found);
+        _Subtree left = _difference(a_left, b->left);
+        _Subtree right = _difference(a_right, b->right);
+        return _join2(left, right);
+    }
+    // 键>=key的节点移到空树right中
+    template <class K>
+    void _split_off(const K& key, __RBTree& right) {
+        _Subtree left_tree, right_tree;
+        __TreeNodeBase* found = _split(_take(), key, left_tree, right_tree);
+        if (found) {
+            _Subtree empty = { nullptr, 0 };
+            right_tree = _join(empty, found, right_tree);
+        }
+        _attach(left_tree);
+        right._attach(right_tree);
+    }
+    // right的节点全部拼到本树之后，right的键须都大于本树的键，否则什么也不做、返回false
+    bool _concat(__RBTree& right) {
+        if (this == &right) return empty();
+        if (right.empty()) return true;
+        if (!empty() && _compare(_key(_header.right), _key(right._header.left)) >= 0) return false;
+        _Subtree left_tree = _take();
+        _attach(_join2(left_tree, right._take()));
+        return true;
+    }
+    // other的节点全部并入本树，other随之为空
+    void _merge(__RBTree& other) {
+        if (this == &other) return;
+        _Subtree mine = _take();
+        _attach(_union(mine, other._take()));
+    }
+    // 删掉也在other中的键
+    void _difference_update(const __RBTree& other) {
+        if (this == &other) { clear();  return; }
+        _attach(_difference(_take(), other._header.parent));
+    }
 
-    // 【左/右旋转】
-    static NodeType* _left_rotate(NodeType* opnode);
-    static NodeType* _right_rotate(NodeType* opnode);
+public:     // 【构造/析构函数】
+    __RBTree() { _header.color = red;  _reset(); }
+    __RBTree(const __RBTree& other): _compare(other._compare) {
+        _header.color = red;
+        _reset();
+        if (!other._header.parent) return;
+        _header.parent = _copy(other._header.parent, &_header);
+        _header.left = mystl::__tree_minimum(_header.parent);
+        _header.right = mystl::__tree_maximum(_header.parent);
+        _count = other._count;
+    }
+    __RBTree(__RBTree&& other): _compare(other._compare) {
+        _header.color = red;
+        _reset();
+        swap(other);
+    }
+    __RBTree& operator=(const __RBTree& other) {
+        if (this != &other) {
+            __RBTree copy(other);
+            swap(copy);
+        }
+        return *this;
+    }
+    __RBTree& operator=(__RBTree&& other) {
+        if (this != &other) {
+            clear();
+            swap(other);
+        }
+        return *this;
+    }
+    ~__RBTree() { clear(); }
 
-    // 【增】
-    NodeType* _insert(NodeType* opnode, const Key& key);
+public:     // 【Basic Accessor】
+    size_type size()    const { return _count; }
+    bool empty()        const { return _count == 0; }
+    iterator begin()    const { return iterator(_header.left); }
+    iterator end()      const { return iterator(_end()); }
 
-    // 【删】
-    NodeType* _erase(NodeType* opnode, const Key& key);
-    static void _clear(NodeType* opnode);
+public:     // 【删】
+    void clear() {
+        _clear(_header.parent);
+        _reset();
+    }
 
-    // 【改、查】
-    static NodeType* _find(NodeType* opnode, const Key& key);
+public:     // 【交换两棵树】只交换树根等指针，再让树根指回各自的_header
+    void swap(__RBTree& other) {
+        std::swap(_compare, other._compare);
+        std::swap(_header.parent, other._header.parent);
+        std::swap(_header.left, other._header.left);
+        std::swap(_header.right, other._header.right);
+        std::swap(_count, other._count);
+        _fix_header();
+        other._fix_header();
+    }
+private:
+    void _fix_header() {
+        if (_header.parent) _header.parent->parent = &_header;
+        else _header.left = _header.right = &_header;
+    }
 };
 
 
-#endif // __RB_TREE__
\ No newline at end of file
+#endif // __RB_TREE__
@@ -1,6 +1,10 @@
 #ifndef __SORT__
 #define __SORT__
+#include <thread>       // thread
+#include <atomic>       // atomic<>
+#include <utility>      // move()
 #include "utils.hpp"
+#include "vector.hpp"   // Vector<>
 
 
 // """基本的排序算法"""
@@ -60,6 +64,124 @@ namespace mystl {
 };
 
 
+// """排序网络"""
+// 小区间（长度<=16）的排序基础情形：插入排序每个元素都要走一次难以预测的分支，
+// 排序网络则是固定次序的“比较-交换”序列，与数据无关，POD类型可编译成cmov/min/max，完全无分支
+// 网络由Bose-Nelson递归构造在编译期展开：n<=8时比较次数即已知最优，9~16时比最优多不到10%
+// 【排序网络不稳定，只用于POD类型的不稳定排序；POD类型用<比较时“相等”即“相同”，故merge_sort()也可用】
+namespace mystl {
+    // 无分支的比较-交换：使a不“大于”b
+    template <class Type, class ItemCompare>
+    inline void __cmp_swap(Type& a, Type& b, const ItemCompare& comp) {
+        bool c = comp(b, a);
+        Type lo = c ? b : a;                        // 三目运算在POD类型上编译为条件传送
+        Type hi = c ? a : b;
+        a = lo;
+        b = hi;
+    }
+
+    // 合并有序的[I, I+X)和[J, J+Y)两段
+    template <size_t I, size_t J, size_t X, size_t Y>
+    struct __BoseNelsonMerge {
+        static const size_t A = X / 2;
+        static const size_t B = (X & 1) ? Y / 2 : (Y + 1) / 2;
+        template <class RandomIterator, class ItemCompare>
+        static void apply(RandomIterator a, const ItemCompare& comp) {
+            __BoseNelsonMerge<I, J, A, B>::apply(a, comp);
+            __BoseNelsonMerge<I+A, J+B, X-A, Y-B>::apply(a, comp);
+            __BoseNelsonMerge<I+A, J, X-A, B>::apply(a, comp);
+        }
+    };
+    template <size_t I, size_t J>
+    struct __BoseNelsonMerge<I, J, 1, 1> {
+        template <class RandomIterator, class ItemCompare>
+        static void apply(RandomIterator a, const ItemCompare& comp)
+            { __cmp_swap(a[I], a[J], comp); }
+    };
+    template <size_t I, size_t J>
+    struct __BoseNelsonMerge<I, J, 1, 2> {
+        template <class RandomIterator, class ItemCompare>
+        static void apply(RandomIterator a, const ItemCompare& comp)
+            { __cmp_swap(a[I], a[J+1], comp);  __cmp_swap(a[I], a[J], comp); }
+    };
+    template <size_t I, size_t J>
+    struct __BoseNelsonMerge<I, J, 2, 1> {
+        template <class RandomIterator, class ItemCompare>
+        static void apply(RandomIterator a, const ItemCompare& comp)
+            { __cmp_swap(a[I], a[J], comp);  __cmp_swap(a[I+1], a[J], comp); }
+    };
+    template <size_t I, size_t J, size_t Y>
+    struct __BoseNelsonMerge<I, J, 0, Y> {          // 某一段为空，无需合并
+        template <class RandomIterator, class ItemCompare>
+        static void apply(RandomIterator, const ItemCompare&) {}
+    };
+    template <size_t I, size_t J, size_t X>
+    struct __BoseNelsonMerge<I, J, X, 0> {
+        template <class RandomIterator, class ItemCompare>
+        static void apply(RandomIterator, const ItemCompare&) {}
+    };
+    template <size_t I, size_t J>
+    struct __BoseNelsonMerge<I, J, 0, 0> {
+        template <class RandomIterator, class ItemCompare>
+        static void apply(RandomIterator, const ItemCompare&) {}
+    };
+
+    // 排序[I, I+M)：两半分别排序后合并
+    template <size_t I, size_t M>
+    struct __BoseNelsonSort {
+        static const size_t L = M / 2;
+        template <class RandomIterator, class ItemCompare>
+        static void apply(RandomIterator a, const ItemCompare& comp) {
+            __BoseNelsonSort<I, L>::apply(a, comp);
+            __BoseNelsonSort<I+L, M-L>::apply(a, comp);
+            __BoseNelsonMerge<I, I+L, L, M-L>::apply(a, comp);
+        }
+    };
+    template <size_t I>
+    struct __BoseNelsonSort<I, 1> {
+        template <class RandomIterator, class ItemCompare>
+        static void apply(RandomIterator, const ItemCompare&) {}
+    };
+
+    // 排序网络：排序[first, first+n)，n<=16时返回true，否则不处理并返回false
+    template <class RandomIterator, class ItemCompare>
+    bool __network_sort(RandomIterator first, ptrdiff_t n, const ItemCompare& comp) {
+        switch (n) {
+            case  2: __BoseNelsonSort<0,  2>::apply(first, comp);  return true;
+            case  3: __BoseNelsonSort<0,  3>::apply(first, comp);  return true;
+            case  4: __BoseNelsonSort<0,  4>::apply(first, comp);  return true;
+            case  5: __BoseNelsonSort<0,  5>::apply(first, comp);  return true;
+            case  6: __BoseNelsonSort<0,  6>::apply(first, comp);  return true;
+            case  7: __BoseNelsonSort<0,  7>::apply(first, comp);  return true;
+            case  8: __BoseNelsonSort<0,  8>::apply(first, comp);  return true;
+            case  9: __BoseNelsonSort<0,  9>::apply(first, comp);  return true;
+            case 10: __BoseNelsonSort<0, 10>::apply(first, comp);  return true;
+            case 11: __BoseNelsonSort<0, 11>::apply(first, comp);  return true;
+            case 12: __BoseNelsonSort<0, 12>::apply(first, comp);  return true;
+            case 13: __BoseNelsonSort<0, 13>::apply(first, comp);  return true;
+            case 14: __BoseNelsonSort<0, 14>::apply(first, comp);  return true;
+            case 15: __BoseNelsonSort<0, 15>::apply(first, comp);  return true;
+            case 16: __BoseNelsonSort<0, 16>::apply(first, comp);  return true;
+            default: return n < 2;                  // 空区间或单元素本就有序
+        }
+    }
+
+    // 小区间排序：对[left, right]区间进行，POD类型走排序网络，其余（及长度>16）走插入排序
+    template <class Type>
+    inline void __small_sort(Type* left, Type* right, TpTrue) {
+        if (!__network_sort(left, right-left+1, Less<Type>())) insertion_sort(left, right);
+    }
+    template <class Type>
+    inline void __small_sort(Type* left, Type* right, TpFalse) {
+        insertion_sort(left, right);
+    }
+    template <class Type>
+    inline void __small_sort(Type* left, Type* right) {
+        __small_sort(left, right, typename TypeTraits<Type>::is_POD_type());
+    }
+};
+
+
 // """快速排序"""
 namespace mystl {
     // [left, right]区间的头、中、尾三元素的“中位数”(指针返回)
@@ -76,22 +198,72 @@ namespace mystl {
         else return right;                          // *left >= *mid, *mid <= *right, *left <= *right   ==>  mid, right, left  ==>  right
     }
 
-    // 快速排序：对[left, right]区间进行
+    // 以*left为pivot划分，返回pivot最终所在位置（Hoare划分）
     template <class Type>
-    void quick_sort(Type* left, Type* right) {
-        if (right - left < 17)                      // 区间长度<=16，调用插入排序
-            return insertion_sort(left, right);     // 递归到底：if (left >= right) return;
-        // "begin partition"
-        iter_swap(left, __median(left, right));     // *left即pivot
-        Type *l=left+1, *r=right;
+    inline Type* __hoare_partition(Type* left, Type* l, Type* r) {
+        // [left+1, l)均<=pivot，r之后（直到区间右端）均>=pivot，只需处理[l, r]
         while (1) {
-            while (*l < *left  &&  l <= r) ++l;     // l<=r和l>r，确保l和r最后停止时错开（不重叠）——
-            while (*r > *left  &&  l <= r) --r;     // r停在“最后一个比pivot小的数”，而l停在“第一个比pivot大的数”
+            while (l <= r  &&  *l < *left) ++l;     // l<=r和l>r，确保l和r最后停止时错开（不重叠）——
+            while (l <= r  &&  *r > *left) --r;     // r停在“最后一个比pivot小的数”，而l停在“第一个比pivot大的数”
             if (l > r) break;
             iter_swap(l++, r--);
         }
         iter_swap(r, left);
-        // "end partition"
+        return r;
+    }
+
+    // 分块无分支划分（BlockQuicksort）：对[left, right]区间进行，*left为pivot
+    // 普通的划分循环在随机数据上约一半的分支预测失败；这里两端各取一块（__block_size个元素），
+    // 先无分支地把“放错边”的元素偏移量记入offsets_l/offsets_r（num += 比较结果），再成批交换
+    // 与__hoare_partition()一样，等于pivot的元素两边都算“放错边”，故大量重复元素时划分依然均衡
+    static const size_t __block_size = 64;
+    template <class Type>
+    Type* __block_partition(Type* left, Type* right) {
+        const Type pivot = *left;
+        unsigned char offsets_l[__block_size], offsets_r[__block_size];
+        size_t num_l=0, num_r=0, start_l=0, start_r=0;
+        Type *l=left+1, *r=right+1;                 // 未划分区间为[l, r)，左块[l, l+B)，右块[r-B, r)
+        while (size_t(r - l) >= 2*__block_size) {
+            if (num_l == 0) {                       // 左块扫描：>=pivot的放错边
+                start_l = 0;
+                for (size_t i=0; i<__block_size; ++i)
+                    { offsets_l[num_l] = (unsigned char)i;  num_l += !(l[i] < pivot); }
+            }
+            if (num_r == 0) {                       // 右块扫描（从右往左）：<=pivot的放错边
+                start_r = 0;
+                for (size_t i=0; i<__block_size; ++i)
+                    { offsets_r[num_r] = (unsigned char)i;  num_r += !(pivot < *(r-1-i)); }
+            }
+            size_t num = min(num_l, num_r);         // 两边放错边的元素一一配对交换
+            for (size_t i=0; i<num; ++i)
+                iter_swap(l + offsets_l[start_l+i], r-1 - offsets_r[start_r+i]);
+            num_l -= num;   start_l += num;
+            num_r -= num;   start_r += num;
+            if (num_l == 0) l += __block_size;      // 某块放错边的元素都换完了，这块就划分好了
+            if (num_r == 0) r -= __block_size;
+        }
+        // 剩余不足两块（含没换完的那一块），交给普通划分【重新扫描已换好的元素不影响正确性】
+        return __hoare_partition(left, l, r-1);
+    }
+
+    // 划分的分派：POD类型（内置整型/浮点/指针等，拷贝与比较都很廉价）用无分支分块划分，其余用普通划分
+    template <class Type>
+    inline Type* __quick_partition(Type* left, Type* right, TpTrue) {
+        return right-left >= ptrdiff_t(2*__block_size) ? 
+            __block_partition(left, right) : __hoare_partition(left, left+1, right);
+    }
+    template <class Type>
+    inline Type* __quick_partition(Type* left, Type* right, TpFalse) {
+        return __hoare_partition(left, left+1, right);
+    }
+
+    // 快速排序：对[left, right]区间进行
+    template <class Type>
+    void quick_sort(Type* left, Type* right) {
+        if (right - left < 17)                      // 区间长度<=16，调用排序网络/插入排序
+            return __small_sort(left, right);       // 递归到底：if (left >= right) return;
+        iter_swap(left, __median(left, right));     // *left即pivot
+        Type* r = __quick_partition(left, right, typename TypeTraits<Type>::is_POD_type());
         quick_sort(left, r-1);
         quick_sort(r+1, right);
     }
@@ -100,7 +272,7 @@ namespace mystl {
     template <class Type>
     void quick_sort_3ways(Type* left, Type* right) {
         if (right - left < 17)
-            return insertion_sort(left, right);
+            return __small_sort(left, right);
         // "begin partition"
         iter_swap(left, __median(left, right));
         Type *lt=left, *gt=right, *cur=left+1;
@@ -132,7 +304,7 @@ namespace mystl {
     template <class Type>
     void __merge_sort(Type* left, Type* right, Type* aux) {
         if (right - left < 17) 
-            return insertion_sort(left, right);         // 递归到底：if (left >= right) return;
+            return __small_sort(left, right);           // 递归到底：if (left >= right) return;
         Type* mid = left + (right-left)/2;
         __merge_sort(left, mid, aux);
         __merge_sort(mid+1, right, aux);
@@ -204,32 +376,663 @@ namespace mystl {
 
 
 // """sort函数及其泛化"""
+// 【泛化版本的ItemCompare均为“小于”语义的函数子：comp(a, b)为true即a应排在b之前，缺省为Less<>】
+// 【泛化版本要求随机访问迭代器（指针、Deque<>迭代器等）】
 namespace mystl {
-    // sort函数：对[first, last)进行
-    // 一般情况：快速排序
-    // 递归层数>2logn：堆排序
-    template <class BidirectIterator>
-    void sort(BidirectIterator first, BidirectIterator last);
-
     // 泛化的插入排序：对[left, right]区间进行
-    template <class BidirectIterator, class ItemCompare>
-    void insertion_sort(BidirectIterator left, BidirectIterator right, ItemCompare comp);
+    template <class RandomIterator, class ItemCompare>
+    void insertion_sort(RandomIterator left, RandomIterator right, ItemCompare comp) {
+        typedef typename IteratorTraits<RandomIterator>::value_type Type;
+        if (right - left < 1) return;
+        for (RandomIterator cur=left+1; right-cur>=0; ++cur) {
+            Type tmp = *cur;                    // [left, cur)已是有序的
+            RandomIterator hole=cur, prev=cur;
+            while (hole != left && comp(tmp, *--prev))
+                { *hole=*prev; hole=prev; }     // 从后往前，将“大于”tmp的各数逐步后移
+            *hole = tmp;
+        }
+    }
+
+    // 泛化的小区间排序：对[left, right]区间进行【不稳定，稳定排序仍用insertion_sort()】
+    template <class RandomIterator, class ItemCompare>
+    inline void __small_sort(RandomIterator left, RandomIterator right, ItemCompare comp, TpTrue) {
+        if (!__network_sort(left, right-left+1, comp)) insertion_sort(left, right, comp);
+    }
+    template <class RandomIterator, class ItemCompare>
+    inline void __small_sort(RandomIterator left, RandomIterator right, ItemCompare comp, TpFalse) {
+        insertion_sort(left, right, comp);
+    }
+    template <class RandomIterator, class ItemCompare>
+    inline void __small_sort(RandomIterator left, RandomIterator right, ItemCompare comp) {
+        typedef typename IteratorTraits<RandomIterator>::value_type Type;
+        __small_sort(left, right, comp, typename TypeTraits<Type>::is_POD_type());
+    }
 
     // 泛化的快速排序：对[left, right]区间进行
-    template <class ForwardIterator, class ItemCompare>
-    ForwardIterator __median(ForwardIterator left, ForwardIterator right, ItemCompare comp);
-    template <class BidirectIterator, class ItemCompare>
-    void quick_sort(BidirectIterator left, BidirectIterator right, ItemCompare comp);
+    template <class RandomIterator, class ItemCompare>
+    RandomIterator __median(RandomIterator left, RandomIterator right, ItemCompare comp) {
+        RandomIterator mid = left + (right-left)/2;
+        if (comp(*left, *mid)) {
+            if (comp(*mid, *right)) return mid;
+            else if (comp(*left, *right)) return right;
+            else return left;
+        }
+        else if (comp(*right, *mid)) return mid;
+        else if (comp(*left, *right)) return left;
+        else return right;
+    }
+    // 以*left为pivot划分[left, right]，返回pivot最终所在位置【与quick_sort(Type*, Type*)的划分逻辑一致】
+    template <class RandomIterator, class ItemCompare>
+    RandomIterator __partition(RandomIterator left, RandomIterator right, ItemCompare comp) {
+        RandomIterator l=left+1, r=right;
+        while (1) {
+            while (r-l >= 0  &&  comp(*l, *left)) ++l;  // 先判断l<=r再解引用，防止*l越界
+            while (r-l >= 0  &&  comp(*left, *r)) --r;
+            if (r-l < 0) break;
+            mystl::swap(*l, *r);  ++l;  --r;
+        }
+        mystl::swap(*r, *left);
+        return r;
+    }
+    template <class RandomIterator, class ItemCompare>
+    void quick_sort(RandomIterator left, RandomIterator right, ItemCompare comp) {
+        while (right - left >= 17) {                // 区间长度<=16，调用排序网络/插入排序
+            mystl::swap(*left, *__median(left, right, comp));
+            RandomIterator mid = __partition(left, right, comp);
+            if (mid - left < right - mid) {         // 递归较短的一边，较长的一边循环处理，栈深度O(logn)
+                if (mid != left) quick_sort(left, mid-1, comp);
+                left = mid + 1;
+            }
+            else {
+                if (mid != right) quick_sort(mid+1, right, comp);
+                if (mid == left) return;
+                right = mid - 1;
+            }
+        }
+        __small_sort(left, right, comp);
+    }
 
     // 泛化的堆排序：对[left, right]区间进行
-    template <class BidirectIterator, class ItemCompare>
-    void __shift_down(BidirectIterator heap_start, size_t heap_size, size_t idx, ItemCompare comp);
-    template <class BidirectIterator, class ItemCompare>
-    void heap_sort(BidirectIterator left, BidirectIterator right, ItemCompare comp);
+    template <class RandomIterator, class ItemCompare>
+    void __shift_down(RandomIterator heap_start, size_t heap_size, size_t idx, ItemCompare comp) {
+        typedef typename IteratorTraits<RandomIterator>::value_type Type;
+        Type tmp = heap_start[idx];
+        size_t child_idx = idx * 2 + 1;
+        while (child_idx < heap_size) {
+            if (child_idx+1 < heap_size  &&
+                comp(heap_start[child_idx], heap_start[child_idx+1])) ++child_idx;
+            if (comp(tmp, heap_start[child_idx])) {
+                heap_start[idx] = heap_start[child_idx];
+                idx = child_idx;
+                child_idx = idx * 2 + 1;
+            }
+            else { break; }
+        }
+        heap_start[idx] = tmp;
+    }
+    template <class RandomIterator, class ItemCompare>
+    void heap_sort(RandomIterator left, RandomIterator right, ItemCompare comp) {
+        if (right - left < 1) return;
+        size_t heap_size = right - left + 1;
+        for (ptrdiff_t i=((right-left)-1)/2; i>=0; --i)
+            __shift_down(left, heap_size, i, comp);
+        while (heap_size > 1) {
+            mystl::swap(*left, left[--heap_size]);
+            __shift_down(left, heap_size, 0, comp);
+        }
+    }
 
     // 泛化的sort函数：对[first, last)进行
-    template <class BidirectIterator, class ItemCompare>
-    void sort(BidirectIterator first, BidirectIterator last, ItemCompare comp);
+    // 一般情况：快速排序
+    // 递归层数>2logn：堆排序
+    template <class RandomIterator, class ItemCompare>
+    void __intro_sort(RandomIterator left, RandomIterator right, size_t depth_limit, ItemCompare comp) {
+        while (right - left >= 17) {
+            if (depth_limit-- == 0)
+                return heap_sort(left, right, comp);
+            mystl::swap(*left, *__median(left, right, comp));
+            RandomIterator mid = __partition(left, right, comp);
+            if (mid - left < right - mid) {
+                if (mid != left) __intro_sort(left, mid-1, depth_limit, comp);
+                left = mid + 1;
+            }
+            else {
+                if (mid != right) __intro_sort(mid+1, right, depth_limit, comp);
+                if (mid == left) return;
+                right = mid - 1;
+            }
+        }
+        __small_sort(left, right, comp);
+    }
+    template <class RandomIterator, class ItemCompare>
+    void sort(RandomIterator first, RandomIterator last, ItemCompare comp) {
+        if (last - first < 2) return;
+        size_t depth_limit = 0;
+        for (size_t n=last-first; n>1; n>>=1) depth_limit += 2;
+        __intro_sort(first, last-1, depth_limit, comp);
+    }
+    template <class RandomIterator>
+    void sort(RandomIterator first, RandomIterator last) {
+        typedef typename IteratorTraits<RandomIterator>::value_type Type;
+        mystl::sort(first, last, Less<Type>());
+    }
+
+    // 泛化的合并排序（稳定）：对[left, right]区间进行【同merge_sort(Type*, Type*)，只支持指针】
+    template <class Type, class ItemCompare>
+    void __merge(Type* left, Type* mid, Type* right, Type* aux, ItemCompare comp) {
+        memcpy(aux, left, (mid-left+1)*sizeof(Type));
+        Type *l=aux, *r=mid+1;
+        mid = aux + (mid-left);
+        while (l<=mid && r<=right)
+            *left++ = comp(*r, *l) ? *r++ : *l++;       // 相等时取左边，保证稳定
+        if (l <= mid)
+            memcpy(left, l, (mid-l+1)*sizeof(Type));
+    }
+    template <class Type, class ItemCompare>
+    void __merge_sort(Type* left, Type* right, Type* aux, ItemCompare comp) {
+        if (right - left < 17)
+            return insertion_sort(left, right, comp);
+        Type* mid = left + (right-left)/2;
+        __merge_sort(left, mid, aux, comp);
+        __merge_sort(mid+1, right, aux, comp);
+        if (comp(*(mid+1), *mid)) __merge(left, mid, right, aux, comp);
+    }
+    template <class Type, class ItemCompare>
+    void merge_sort(Type* left, Type* right, ItemCompare comp) {
+        if (right - left < 1) return;
+        Type* auxiliary = (Type*)malloc( ((right-left+1)/2+1) * sizeof(Type) );
+        __merge_sort(left, right, auxiliary, comp);
+        free(auxiliary);
+    }
+};
+
+
+// """部分排序与选择"""
+// 只需要前K个/第K个时，不必整体排序：
+// partial_sort()：堆选择，O(nlogK)
+// nth_element()：introselect，即快速选择（每次只进入nth所在的一边），期望O(n)；划分层数>2logn则改用堆选择
+namespace mystl {
+    // 将大小为k的最大堆[first, first+k)堆排序
+    template <class RandomIterator, class ItemCompare>
+    void __sort_heap(RandomIterator first, size_t k, ItemCompare comp) {
+        while (k > 1) {
+            mystl::swap(*first, first[--k]);
+            __shift_down(first, k, 0, comp);
+        }
+    }
+
+    // 部分排序：使[first, middle)为[first, last)中最小的middle-first个元素且有序，[middle, last)次序不定
+    template <class RandomIterator, class ItemCompare>
+    void partial_sort(RandomIterator first, RandomIterator middle, RandomIterator last, ItemCompare comp) {
+        size_t k = middle - first;
+        if (k == 0) return;
+        for (ptrdiff_t i=(ptrdiff_t(k)-2)/2; i>=0; --i)    // [first, middle)建最大堆，堆顶即“目前第k小”
+            __shift_down(first, k, i, comp);
+        for (RandomIterator cur=middle; last-cur>0; ++cur)  // 比堆顶小的元素换入堆中
+            if (comp(*cur, *first)) {
+                mystl::swap(*cur, *first);
+                __shift_down(first, k, 0, comp);
+            }
+        __sort_heap(first, k, comp);
+    }
+    template <class RandomIterator>
+    void partial_sort(RandomIterator first, RandomIterator middle, RandomIterator last) {
+        typedef typename IteratorTraits<RandomIterator>::value_type Type;
+        mystl::partial_sort(first, middle, last, Less<Type>());
+    }
+
+    // 部分排序并拷贝：将[first, last)中最小的min(n, k)个元素有序地拷贝到[result_first, result_last)，返回拷贝结束位置
+    template <class InputIterator, class RandomIterator, class ItemCompare>
+    RandomIterator partial_sort_copy(InputIterator first, InputIterator last, 
+                                     RandomIterator result_first, RandomIterator result_last, ItemCompare comp) {
+        size_t k = 0;
+        for (; first!=last && result_last-result_first>ptrdiff_t(k); ++first, ++k)
+            result_first[k] = *first;
+        if (k == 0) return result_first;
+        for (ptrdiff_t i=(ptrdiff_t(k)-2)/2; i>=0; --i)
+            __shift_down(result_first, k, i, comp);
+        for (; first!=last; ++first)                        // 原区间不动，只拷贝比堆顶小的元素
+            if (comp(*first, *result_first)) {
+                *result_first = *first;
+                __shift_down(result_first, k, 0, comp);
+            }
+        __sort_heap(result_first, k, comp);
+        return result_first + k;
+    }
+    template <class InputIterator, class RandomIterator>
+    RandomIterator partial_sort_copy(InputIterator first, InputIterator last, 
+                                     RandomIterator result_first, RandomIterator result_last) {
+        typedef typename IteratorTraits<RandomIterator>::value_type Type;
+        return mystl::partial_sort_copy(first, last, result_first, result_last, Less<Type>());
+    }
+
+    // 选择：使*nth恰为排序后该位置上的元素，且[first, nth)均不大于*nth、(nth, last)均不小于*nth
+    template <class RandomIterator, class ItemCompare>
+    void nth_element(RandomIterator first, RandomIterator nth, RandomIterator last, ItemCompare comp) {
+        if (last - first < 2 || last - nth <= 0) return;
+        size_t depth_limit = 0;
+        for (size_t n=last-first; n>1; n>>=1) depth_limit += 2;
+        RandomIterator left=first, right=last-1;
+        while (right - left >= 17) {
+            if (depth_limit-- == 0) {                       // 划分总是很不均衡，改用堆选择保证O(nlogn)
+                mystl::partial_sort(left, nth+1, right+1, comp);
+                return;
+            }
+            mystl::swap(*left, *__median(left, right, comp));
+            RandomIterator mid = __partition(left, right, comp);
+            if (mid == nth) return;
+            if (nth - mid < 0) right = mid - 1;             // 只进入nth所在的一边
+            else               left = mid + 1;
+        }
+        __small_sort(left, right, comp);
+    }
+    template <class RandomIterator>
+    void nth_element(RandomIterator first, RandomIterator nth, RandomIterator last) {
+        typedef typename IteratorTraits<RandomIterator>::value_type Type;
+        mystl::nth_element(first, nth, last, Less<Type>());
+    }
+};
+
+
+// """元素搬移"""
+// 归并类排序要把元素成块地挪到辅助空间再挪回来：POD类型直接memcpy/memmove，
+// 其余类型（如string，可能持有指向自身的指针）不能按位搬移，只能逐个move，搬移后的对象仍完整有效
+// 辅助空间是malloc来的原始内存，搬入时要move构造，用完后要析构
+namespace mystl {
+    inline bool __is_POD(TpTrue) { return true; }
+    inline bool __is_POD(TpFalse) { return false; }
+
+    // 将[first, last)移到dest开始处（dest在first之前，或二者不重叠）
+    template <class Type>
+    inline void __move_forward(Type* first, Type* last, Type* dest, TpTrue) 
+        { memmove(dest, first, (last-first)*sizeof(Type)); }
+    template <class Type>
+    inline void __move_forward(Type* first, Type* last, Type* dest, TpFalse) 
+        { for (; first<last; ++first, ++dest) *dest = std::move(*first); }
+    template <class Type>
+    inline void __move_forward(Type* first, Type* last, Type* dest) 
+        { __move_forward(first, last, dest, typename TypeTraits<Type>::is_POD_type()); }
+
+    // 将[first, last)移到dest_last结尾处（dest_last在last之后，或二者不重叠）
+    template <class Type>
+    inline void __move_backward(Type* first, Type* last, Type* dest_last, TpTrue) 
+        { memmove(dest_last-(last-first), first, (last-first)*sizeof(Type)); }
+    template <class Type>
+    inline void __move_backward(Type* first, Type* last, Type* dest_last, TpFalse) 
+        { while (first < last) *--dest_last = std::move(*--last); }
+    template <class Type>
+    inline void __move_backward(Type* first, Type* last, Type* dest_last) 
+        { __move_backward(first, last, dest_last, typename TypeTraits<Type>::is_POD_type()); }
+
+    // 将[first, last)移到未构造的dest开始处（二者不重叠）
+    template <class Type>
+    inline void __move_construct(Type* first, Type* last, Type* dest, TpTrue) 
+        { memcpy(dest, first, (last-first)*sizeof(Type)); }
+    template <class Type>
+    inline void __move_construct(Type* first, Type* last, Type* dest, TpFalse) 
+        { for (; first<last; ++first, ++dest) new (dest) Type(std::move(*first)); }
+    template <class Type>
+    inline void __move_construct(Type* first, Type* last, Type* dest) 
+        { __move_construct(first, last, dest, typename TypeTraits<Type>::is_POD_type()); }
+};
+
+
+// """自适应稳定排序stable_sort（Timsort/powersort）"""
+// (1)从左往右找出天然有序的run（严格降序的run原地反转），太短的run用二分插入排序补足到min_run
+// (2)run依次压栈，按powersort的“节点深度”规则决定何时合并栈顶的相邻run，合并树接近最优且栈深度O(logn)
+// (3)合并前先“飞奔(gallop)”裁掉两端已就位的部分；合并中某一边连续胜出min_gallop次后，
+//    改为指数查找、成块搬移。辅助空间与__merge()一样只需n/2+1，较短的run搬到aux再合并回去
+//    【元素经__move_...()搬移，非POD类型在aux中move构造、合并完析构，string等也可以排】
+// 对已有序、逆序、分批有序的数据接近O(n)，一般数据O(nlogn)
+namespace mystl {
+    static const size_t __min_gallop = 7;   // 连续胜出多少次后进入飞奔模式（初始值）
+
+    // a[0, n)开头连续满足pred的元素个数（pred须“前真后假”），从左端指数查找+二分
+    template <class Type, class Pred>
+    size_t __gallop_prefix(const Type* a, size_t n, Pred pred) {
+        size_t lo = 0, hi = 1;                  // a[0, lo)均满足pred，检查a[0], a[2], a[6], a[14]...
+        while (hi <= n && pred(a[hi-1])) { lo = hi; hi = hi*2+1; }
+        size_t end = hi<=n ? hi-1 : n;          // a[end]不满足pred（或end==n），答案在[lo, end]
+        while (lo < end) {
+            size_t mid = lo + (end-lo)/2;
+            if (pred(a[mid])) lo = mid + 1;
+            else end = mid;
+        }
+        return lo;
+    }
+    // a[0, n)末尾连续满足pred的元素个数（pred须“前假后真”），从右端指数查找+二分
+    template <class Type, class Pred>
+    size_t __gallop_suffix(const Type* a, size_t n, Pred pred) {
+        size_t lo = 0, hi = 1;
+        while (hi <= n && pred(a[n-hi])) { lo = hi; hi = hi*2+1; }
+        size_t end = hi<=n ? hi-1 : n;
+        while (lo < end) {
+            size_t mid = lo + (end-lo)/2;
+            if (pred(a[n-1-mid])) lo = mid + 1;
+            else end = mid;
+        }
+        return lo;
+    }
+
+    // 合并相邻的有序run：a[0, na)与紧随其后的b[0, nb)，na<=nb时使用 —— a拷贝到aux，从左往右合并
+    template <class Type, class ItemCompare>
+    void __merge_lo(Type* a, size_t na, Type* b, size_t nb, Type* aux, ItemCompare comp, size_t& min_gallop) {
+        __move_construct(a, a+na, aux);
+        Type *pa=aux, *pa_end=aux+na, *pb=b, *pb_end=b+nb, *dest=a;
+        while (pa<pa_end && pb<pb_end) {
+            // 逐个比较，直到某一边连续胜出min_gallop次
+            size_t wins_a=0, wins_b=0;
+            while (pa<pa_end && pb<pb_end && wins_a<min_gallop && wins_b<min_gallop) {
+                if (comp(*pb, *pa)) { *dest++ = std::move(*pb++);  ++wins_b;  wins_a=0; }
+                else                { *dest++ = std::move(*pa++);  ++wins_a;  wins_b=0; }
+            }
+            // 飞奔模式：指数查找对方当前元素的位置，成块拷贝，直到两边每次都拷不了几个
+            size_t ka=0, kb=0;
+            do {
+                if (pa==pa_end || pb==pb_end) break;
+                if (min_gallop > 1) --min_gallop;
+                ka = __gallop_prefix(pa, pa_end-pa, [&](const Type& x) { return !comp(*pb, x); });
+                __move_forward(pa, pa+ka, dest);  dest+=ka;  pa+=ka;
+                if (pa == pa_end) break;
+                *dest++ = std::move(*pb++);
+                if (pb == pb_end) break;
+                kb = __gallop_prefix(pb, pb_end-pb, [&](const Type& x) { return comp(x, *pa); });
+                __move_forward(pb, pb+kb, dest);  dest+=kb;  pb+=kb;  // dest与pb可能重叠，dest在前
+                if (pb == pb_end) break;
+                *dest++ = std::move(*pa++);
+            } while (ka >= __min_gallop || kb >= __min_gallop);
+            min_gallop += 2;                    // 飞奔不划算了，提高再次进入的门槛
+        }
+        __move_forward(pa, pa_end, dest);       // b的剩余部分本来就在原位
+        mystl::destroy(aux, aux+na);
+    }
+
+    // 合并相邻的有序run：a[0, na)与紧随其后的b[0, nb)，na>nb时使用 —— b拷贝到aux，从右往左合并
+    template <class Type, class ItemCompare>
+    void __merge_hi(Type* a, size_t na, Type* b, size_t nb, Type* aux, ItemCompare comp, size_t& min_gallop) {
+        __move_construct(b, b+nb, aux);
+        Type *pa=a+na, *pb=aux+nb, *dest=b+nb;  // 各游标均指向“下一个要处理的元素的后一个”
+        while (pa>a && pb>aux) {
+            size_t wins_a=0, wins_b=0;
+            while (pa>a && pb>aux && wins_a<min_gallop && wins_b<min_gallop) {
+                if (comp(*(pb-1), *(pa-1))) { *--dest = std::move(*--pa);  ++wins_a;  wins_b=0; }
+                else                        { *--dest = std::move(*--pb);  ++wins_b;  wins_a=0; }
+            }
+            size_t ka=0, kb=0;
+            do {
+                if (pa==a || pb==aux) break;
+                if (min_gallop > 1) --min_gallop;
+                ka = __gallop_suffix(a, pa-a, [&](const Type& x) { return comp(*(pb-1), x); });
+                __move_backward(pa-ka, pa, dest);  dest-=ka;  pa-=ka;   // dest与pa可能重叠，dest在后
+                if (pa == a) break;
+                *--dest = std::move(*--pb);
+                if (pb == aux) break;
+                kb = __gallop_suffix(aux, pb-aux, [&](const Type& x) { return !comp(x, *(pa-1)); });
+                dest-=kb;  pb-=kb;  __move_forward(pb, pb+kb, dest);
+                if (pb == aux) break;
+                *--dest = std::move(*--pa);
+            } while (ka >= __min_gallop || kb >= __min_gallop);
+            min_gallop += 2;
+        }
+        __move_forward(aux, pb, dest-(pb-aux)); // a的剩余部分本来就在原位
+        mystl::destroy(aux, aux+nb);
+    }
+
+    // 合并相邻的有序run a[0, na)与b[0, nb)
+    template <class Type, class ItemCompare>
+    void __merge_runs(Type* a, size_t na, Type* b, size_t nb, Type* aux, ItemCompare comp, size_t& min_gallop) {
+        // a中<=b[0]的前缀、b中>=a[na-1]的后缀都已就位，先裁掉
+        size_t k = __gallop_prefix(a, na, [&](const Type& x) { return !comp(*b, x); });
+        a += k;  na -= k;
+        if (na == 0) return;
+        const Type& a_last = a[na-1];
+        nb -= __gallop_suffix(b, nb, [&](const Type& x) { return !comp(x, a_last); });
+        if (nb == 0) return;
+        if (na <= nb) __merge_lo(a, na, b, nb, aux, comp, min_gallop);
+        else          __merge_hi(a, na, b, nb, aux, comp, min_gallop);
+    }
+
+    // 从first开始的run长度；严格降序的run原地反转（严格才能保证稳定）
+    template <class Type, class ItemCompare>
+    size_t __count_run(Type* first, Type* last, ItemCompare comp) {
+        Type* cur = first + 1;
+        if (cur == last) return 1;
+        if (comp(*cur, *first)) {
+            while (cur+1 < last && comp(*(cur+1), *cur)) ++cur;
+            for (Type *l=first, *r=cur; l<r; ++l, --r) iter_swap(l, r);
+        }
+        else {
+            while (cur+1 < last && !comp(*(cur+1), *cur)) ++cur;
+        }
+        return (cur+1) - first;
+    }
+
+    // 二分插入排序：[first, start)已有序，将[start, last)逐个插入
+    template <class Type, class ItemCompare>
+    void __binary_insertion_sort(Type* first, Type* start, Type* last, ItemCompare comp) {
+        for (; start<last; ++start) {
+            Type *lo=first, *hi=start;          // 找到第一个“大于”*start的位置，保证稳定
+            while (lo < hi) {
+                Type* mid = lo + (hi-lo)/2;
+                if (comp(*start, *mid)) hi = mid;
+                else lo = mid + 1;
+            }
+            if (lo == start) continue;
+            Type tmp(std::move(*start));
+            __move_backward(lo, start, start+1);
+            *lo = std::move(tmp);
+        }
+    }
+
+    // 最短run长度：取n的最高6位，若剩下的位中有1则+1，使n/min_run恰为或略小于2的幂
+    inline size_t __min_run(size_t n) {
+        size_t r = 0;
+        while (n >= 64) { r |= n & 1;  n >>= 1; }
+        return n + r;
+    }
+
+    // powersort：相邻两run [s1, s1+n1) 与 [s1+n1, s1+n1+n2) 之间的“节点深度”（总长为n）
+    inline int __node_power(size_t s1, size_t n1, size_t n2, size_t n) {
+        size_t a = 2*s1 + n1, b = a + n1 + n2;  // 两run中点的2倍，逐位比较a/2n与b/2n的二进制小数
+        int power = 0;
+        while (1) {
+            ++power;
+            if (a >= n) { a -= n;  b -= n; }
+            else if (b >= n) break;
+            a <<= 1;  b <<= 1;
+        }
+        return power;
+    }
+
+    // 自适应稳定排序：对[first, last)进行
+    template <class Type, class ItemCompare>
+    void stable_sort(Type* first, Type* last, ItemCompare comp) {
+        size_t n = last>first ? last-first : 0;
+        if (n < 2) return;
+        if (n < 64) {                           // 太短，直接二分插入排序
+            __binary_insertion_sort(first, first+__count_run(first, last, comp), last, comp);
+            return;
+        }
+        size_t min_run = __min_run(n), min_gallop = __min_gallop;
+        Type* aux = (Type*)malloc((n/2+1) * sizeof(Type));
+        size_t run_base[85], run_len[85];       // run栈：栈中相邻run的power严格递增，深度不超过logn+1
+        int run_power[85];                      // run_power[i]即run i与run i+1之间的节点深度
+        size_t nruns = 0;
+        for (Type* cur=first; cur<last; ) {
+            size_t len = __count_run(cur, last, comp);
+            if (len < min_run) {                // 太短的run补足到min_run
+                size_t force = min(min_run, size_t(last-cur));
+                __binary_insertion_sort(cur, cur+len, cur+force, comp);
+                len = force;
+            }
+            if (nruns > 0) {
+                int power = __node_power(run_base[nruns-1], run_len[nruns-1], len, n);
+                while (nruns > 1 && run_power[nruns-2] > power) {   // 栈顶两run之间的节点更深，先合并它们
+                    __merge_runs(first+run_base[nruns-2], run_len[nruns-2],
+                                 first+run_base[nruns-1], run_len[nruns-1], aux, comp, min_gallop);
+                    run_len[nruns-2] += run_len[nruns-1];
+                    --nruns;
+                }
+                run_power[nruns-1] = power;
+            }
+            run_base[nruns] = cur - first;
+            run_len[nruns] = len;
+            ++nruns;
+            cur += len;
+        }
+        for (; nruns > 1; --nruns) {            // 自顶向下合并剩余的run
+            __merge_runs(first+run_base[nruns-2], run_len[nruns-2],
+                         first+run_base[nruns-1], run_len[nruns-1], aux, comp, min_gallop);
+            run_len[nruns-2] += run_len[nruns-1];
+        }
+        free(aux);
+    }
+    template <class Type>
+    void stable_sort(Type* first, Type* last) 
+        { mystl::stable_sort(first, last, Less<Type>()); }
+};
+
+
+// """并行排序"""
+// 思路：
+// (1)将[first, last)均分为P块（P为硬件线程数），各线程用上边的sort()/stable_sort()分别排好自己那块
+// (2)逐轮两两合并，共⌈logP⌉轮；每轮的每一对又按“合并路径(merge path)”切成若干段，
+//    使得最后几轮（只剩一两对）时所有线程也都有活干；切分点要在整对数据上二分查找，
+//    故每轮先算好所有切分点，再开始搬移元素（否则别的段可能正在比较已被move走的元素）
+// (3)合并在原数组与等长辅助空间之间来回进行；非POD类型先把排好的各块move构造到辅助空间，
+//    之后两边都是构造好的对象，逐个move即可，最后统一析构辅助空间
+namespace mystl {
+    static const size_t __parallel_min_chunk = 1 << 14;    // 每个线程至少分到的元素个数，太少则不值得开线程
+
+    // 硬件线程数
+    inline size_t __hardware_threads() {
+        size_t n = thread::hardware_concurrency();
+        return n ? n : 1;
+    }
+
+    // 简易线程池：nthreads个线程从共享计数器领取task(0)...task(ntasks-1)执行，全部完成后返回
+    template <class Task>
+    void __parallel_for(size_t ntasks, size_t nthreads, const Task& task) {
+        if (nthreads > ntasks) nthreads = ntasks;
+        atomic<size_t> next(0);
+        auto worker = [&]() {
+            for (size_t i=next++; i<ntasks; i=next++) task(i);
+        };
+        thread* pool = (thread*)malloc(sizeof(thread) * nthreads);
+        for (size_t i=1; i<nthreads; ++i) new (pool+i) thread(worker);
+        worker();                                   // 主调线程也干活
+        for (size_t i=1; i<nthreads; ++i) { pool[i].join(); pool[i].~thread(); }
+        free(pool);
+    }
+
+    // 合并路径：有序的a[0, na)与b[0, nb)合并后的前k个元素中，有多少个来自a（相等时a在前，保证稳定）
+    template <class Type, class ItemCompare>
+    size_t __merge_path(const Type* a, size_t na, const Type* b, size_t nb, size_t k, ItemCompare comp) {
+        size_t lo = k>nb ? k-nb : 0, hi = k<na ? k : na;
+        while (lo < hi) {
+            size_t i = lo + (hi-lo)/2;
+            if (!comp(b[k-i-1], a[i])) lo = i + 1;  // a[i] <= b[k-i-1]，则a[i]必在前k个之中
+            else hi = i;
+        }
+        return lo;
+    }
+
+    // 将有序的[a, a_end)与[b, b_end)合并到out开始的空间（out与a、b不重叠，且已构造）
+    template <class Type, class ItemCompare>
+    void __merge_to(Type* a, Type* a_end, Type* b, Type* b_end, Type* out, ItemCompare comp) {
+        while (a<a_end && b<b_end)
+            *out++ = std::move(comp(*b, *a) ? *b++ : *a++);
+        __move_forward(a, a_end, out);  out += a_end-a;
+        __move_forward(b, b_end, out);
+    }
+
+    // 并行排序的主体：stable决定各块用stable_sort()还是sort()
+    template <class Type, class ItemCompare>
+    void __parallel_sort(Type* first, Type* last, ItemCompare comp, bool stable) {
+        size_t n = last>first ? last-first : 0;
+        if (n < 2) return;
+        size_t nthreads = __hardware_threads();
+        if (nthreads > n/__parallel_min_chunk) nthreads = n/__parallel_min_chunk;
+        if (nthreads <= 1) {                        // 数据量太小或单核，直接顺序排序
+            if (stable) mystl::stable_sort(first, last, comp);
+            else        mystl::sort(first, last, comp);
+            return;
+        }
+        // (1)分块各自排序
+        size_t nruns = nthreads;
+        size_t* bounds = (size_t*)malloc((nruns+1) * sizeof(size_t));   // 第i块为[bounds[i], bounds[i+1])
+        for (size_t i=0; i<=nruns; ++i) bounds[i] = n * i / nruns;
+        __parallel_for(nruns, nthreads, [&](size_t i) {
+            if (stable) mystl::stable_sort(first+bounds[i], first+bounds[i+1], comp);
+            else        mystl::sort(first+bounds[i], first+bounds[i+1], comp);
+        });
+        // (2)逐轮两两合并
+        Type* buffer = (Type*)malloc(n * sizeof(Type));
+        Type *src=first, *dst=buffer;
+        bool is_POD = __is_POD(typename TypeTraits<Type>::is_POD_type());
+        if (!is_POD) {                              // 非POD类型：各块先move构造到辅助空间，从那里开始合并
+            __parallel_for(nruns, nthreads, [&](size_t i) {
+                __move_construct(first+bounds[i], first+bounds[i+1], buffer+bounds[i]);
+            });
+            src = buffer;  dst = first;
+        }
+        // 每轮第p对的第q个切分点（合并结果的前(na+nb)*q/parts个元素中来自a的个数）存于cuts[p*(parts+1)+q]
+        size_t* cuts = (size_t*)malloc((nthreads+nruns) * sizeof(size_t));
+        while (nruns > 1) {
+            size_t npairs = nruns / 2;
+            size_t parts = nthreads/npairs ? nthreads/npairs : 1;  // 每一对切成parts段
+            size_t ntasks = npairs*parts + (nruns&1);               // 落单的最后一块直接拷贝
+            __parallel_for(npairs*(parts+1), nthreads, [&](size_t t) {
+                size_t p = t / (parts+1), q = t % (parts+1);
+                size_t na = bounds[2*p+1] - bounds[2*p], nb = bounds[2*p+2] - bounds[2*p+1];
+                cuts[t] = __merge_path(src+bounds[2*p], na, src+bounds[2*p+1], nb, (na+nb)*q/parts, comp);
+            });
+            __parallel_for(ntasks, nthreads, [&](size_t t) {
+                size_t p = t / parts, q = t % parts;
+                if (p == npairs) {
+                    size_t lo = bounds[2*p], hi = bounds[2*p+1];
+                    __move_forward(src+lo, src+hi, dst+lo);
+                    return;
+                }
+                Type* a = src + bounds[2*p];
+                Type* b = src + bounds[2*p+1];
+                size_t na = bounds[2*p+1] - bounds[2*p], nb = bounds[2*p+2] - bounds[2*p+1];
+                size_t k0 = (na+nb)*q/parts, k1 = (na+nb)*(q+1)/parts;
+                size_t i0 = cuts[p*(parts+1)+q], i1 = cuts[p*(parts+1)+q+1];
+                __merge_to(a+i0, a+i1, b+(k0-i0), b+(k1-i1), dst+bounds[2*p]+k0, comp);
+            });
+            for (size_t i=0; i<=npairs; ++i)        // 合并后的第i块为原来的第2i、2i+1块
+                bounds[i] = bounds[2*i<nruns ? 2*i : nruns];
+            bounds[(nruns+1)/2] = n;
+            nruns = (nruns+1) / 2;
+            Type* tmp=src;  src=dst;  dst=tmp;
+        }
+        if (src != first)                           // 结果在辅助空间，分块拷贝回去
+            __parallel_for(nthreads, nthreads, [&](size_t i) {
+                size_t lo = n*i/nthreads, hi = n*(i+1)/nthreads;
+                __move_forward(buffer+lo, buffer+hi, first+lo);
+            });
+        if (!is_POD) mystl::destroy(buffer, buffer+n);
+        free(buffer);
+        free(cuts);
+        free(bounds);
+    }
+
+    // 并行排序：对[first, last)进行，不稳定
+    template <class Type, class ItemCompare>
+    void parallel_sort(Type* first, Type* last, ItemCompare comp) 
+        { __parallel_sort(first, last, comp, false); }
+    template <class Type>
+    void parallel_sort(Type* first, Type* last) 
+        { __parallel_sort(first, last, Less<Type>(), false); }
+
+    // 并行稳定排序：对[first, last)进行，相等元素保持原有先后次序
+    template <class Type, class ItemCompare>
+    void parallel_stable_sort(Type* first, Type* last, ItemCompare comp) 
+        { __parallel_sort(first, last, comp, true); }
+    template <class Type>
+    void parallel_stable_sort(Type* first, Type* last) 
+        { __parallel_sort(first, last, Less<Type>(), true); }
 };
 
 
@@ -237,6 +1040,193 @@ namespace mystl {
 // 思路：
 // 用哪种排序算法来实现都可以
 // 比较的时候用array[indexes[i]]和array[indexes[j]]比，而移动的时候是像indexes[i] = indexes[j]这样即可
+// 这样排序过程中只移动size_t下标，待排好后再用apply_permutation...()一次性把大对象挪到位
+namespace mystl {
+    // 比较下标所指元素的函数子
+    template <class Type, class ItemCompare>
+    struct __IndexCompare {
+        const Type* array;
+        ItemCompare comp;
+        __IndexCompare(const Type* arr, ItemCompare item_comp): array(arr), comp(item_comp) {}
+        bool operator()(size_t i, size_t j) const { return comp(array[i], array[j]); }
+    };
+
+    // 返回使[first, last)有序的下标序列，即first[indexes[0]], first[indexes[1]]...有序【稳定，原数组不动】
+    template <class Type, class ItemCompare>
+    Vector<size_t> argsort(const Type* first, const Type* last, ItemCompare comp) {
+        size_t n = last>first ? last-first : 0;
+        Vector<size_t> indexes(n);
+        for (size_t i=0; i<n; ++i) indexes[i] = i;
+        if (n > 1)
+            merge_sort(indexes.begin(), indexes.end()-1, __IndexCompare<Type, ItemCompare>(first, comp));
+        return indexes;
+    }
+    template <class Type>
+    Vector<size_t> argsort(const Type* first, const Type* last) 
+        { return argsort(first, last, Less<Type>()); }
+
+    // 按下标序列重排，返回新数组result，result[i] = first[perm[i]]【原数组不动】
+    template <class Type>
+    Vector<Type> apply_permutation(const Type* first, const Type* last, const Vector<size_t>& perm) {
+        size_t n = last>first ? last-first : 0;
+        Vector<Type> result = Vector<Type>::static_construct(n);
+        if (perm.size() != n) {
+            cerr << "warning: permutation size(" << perm.size() << ") != range size(" << n << ")!" << endl;
+            return result;
+        }
+        for (size_t i=0; i<n; ++i)
+            result.push_back(first[perm[i]]);
+        return result;
+    }
+
+    // 按下标序列原地重排，使first[i]变为原来的first[perm[i]]
+    // 沿置换的每个环依次挪动，每个元素恰好move一次，额外空间只有n个标记和一个暂存的元素
+    template <class Type>
+    void apply_permutation_inplace(Type* first, Type* last, const Vector<size_t>& perm) {
+        size_t n = last>first ? last-first : 0;
+        if (perm.size() != n) {
+            cerr << "warning: permutation size(" << perm.size() << ") != range size(" << n << ")!" << endl;
+            return;
+        }
+        Vector<char> done(n, 0);
+        for (size_t i=0; i<n; ++i) {
+            if (done[i] || perm[i]==i) continue;
+            Type tmp(std::move(first[i]));          // 暂存环的起点，其位置将被环上下一个元素覆盖
+            size_t cur = i;
+            while (perm[cur] != i) {
+                first[cur] = std::move(first[perm[cur]]);
+                done[cur] = 1;
+                cur = perm[cur];
+            }
+            first[cur] = std::move(tmp);
+            done[cur] = 1;
+        }
+    }
+};
+
+
+// """字符串排序"""
+// 思路：多键快排（multikey quicksort，即三路基数快排）
+// 按第d个字符三路划分：<、>两部分仍比第d个字符，=部分（前d+1个字符都相同）才进入第d+1个字符
+// 这样公共前缀上的每个字符只比较一次，而不是像strcmp()那样在每次比较中都从头重新扫描
+// (1)先把每个串转成{首地址, 长度, 原下标}的连续数组，长度不必再从string对象里取
+// (2)每进入新的一层，先把该层所有串的第d个字符读入cache[]，划分时只比较、移动cache[]和数组本身，
+//    每个串每层只访问一次字符内容，避免反复的指针跳转与缓存缺失
+// (3)某层划分后所有串都落在=部分时，直接求整桶的公共前缀一次跳过，长公共前缀不必逐字符逐层划分
+// (4)桶中不足__string_insertion_threshold个串时，改用从第d个字符起比较后缀的插入排序
+// 字符按unsigned char比较，与strcmp()、string::compare()的结果一致【不稳定】
+namespace mystl {
+    static const size_t __string_insertion_threshold = 16;
+
+    struct __StringItem {
+        const unsigned char* str;
+        size_t len;
+        size_t idx;         // 在原数组中的下标
+    };
+
+    // 第d个字符，越过末尾则为-1（排在所有字符之前，即短串在前）
+    inline int __char_at(const __StringItem& s, size_t d) 
+        { return d < s.len ? s.str[d] : -1; }
+
+    // 前d个字符已知相同，比较后缀
+    inline bool __suffix_less(const __StringItem& a, const __StringItem& b, size_t d) {
+        size_t la=a.len-d, lb=b.len-d;
+        int c = memcmp(a.str+d, b.str+d, la<lb ? la : lb);
+        return c < 0 || (c == 0 && la < lb);
+    }
+
+    // 插入排序：对[a, a+n)按后缀进行
+    inline void __string_insertion_sort(__StringItem* a, size_t n, size_t d) {
+        for (size_t i=1; i<n; ++i) {
+            __StringItem tmp = a[i];
+            size_t j = i;
+            for (; j>0 && __suffix_less(tmp, a[j-1], d); --j) a[j] = a[j-1];
+            a[j] = tmp;
+        }
+    }
+
+    // [a, a+n)在第d个字符起的最长公共前缀长度：整桶只剩公共前缀时一次顺序扫描跳过，而不是逐层划分
+    inline size_t __common_prefix(const __StringItem* a, size_t n, size_t d) {
+        size_t lcp = a[0].len - d;
+        for (size_t i=1; i<n && lcp>0; ++i) {
+            size_t k = 0, len = a[i].len-d < lcp ? a[i].len-d : lcp;
+            while (k < len && a[i].str[d+k] == a[0].str[d+k]) ++k;
+            lcp = k;
+        }
+        return lcp;
+    }
+
+    inline void __string_swap(__StringItem* a, int* cache, size_t i, size_t j) {
+        __StringItem tmp=a[i];  a[i]=a[j];  a[j]=tmp;
+        int c=cache[i];  cache[i]=cache[j];  cache[j]=c;
+    }
+
+    // 多键快排：对[a, a+n)进行，前d个字符均相同；cached表示cache[]已是第d个字符
+    inline void __multikey_quick_sort(__StringItem* a, int* cache, size_t n, size_t d, bool cached) {
+        while (n >= __string_insertion_threshold) {
+            if (!cached)
+                for (size_t i=0; i<n; ++i) cache[i] = __char_at(a[i], d);
+            int x=cache[0], y=cache[n/2], z=cache[n-1];     // 三数取中
+            int pivot = x < y ? (y < z ? y : (x < z ? z : x)) : (x < z ? x : (y < z ? z : y));
+            size_t lt=0, cur=0, gt=n;                       // [0, lt)<pivot，[lt, cur)==pivot，[gt, n)>pivot
+            while (cur < gt) {
+                if (cache[cur] < pivot)      __string_swap(a, cache, lt++, cur++);
+                else if (cache[cur] > pivot) __string_swap(a, cache, cur, --gt);
+                else                         ++cur;
+            }
+            __multikey_quick_sort(a, cache, lt, d, true);               // <、>两部分的cache[]仍有效
+            __multikey_quick_sort(a+gt, cache+gt, n-gt, d, true);
+            if (pivot < 0) return;                          // =部分都已到末尾，即完全相同的串
+            bool all_equal = (lt == 0 && gt == n);          // 整桶第d个字符都相同，多半是长公共前缀（URL等）
+            a += lt;  cache += lt;  n = gt-lt;  ++d;  cached = false;   // =部分进入下一个字符
+            if (all_equal) d += __common_prefix(a, n, d);
+        }
+        __string_insertion_sort(a, n, d);
+    }
+
+    inline void __string_sort(__StringItem* items, size_t n) {
+        if (n < 2) return;
+        Vector<int> cache(n);
+        __multikey_quick_sort(items, cache.begin(), n, 0, false);
+    }
+
+    // 字符串排序：对[first, last)的C风格字符串进行（只重排指针）
+    inline void string_sort(const char** first, const char** last) {
+        size_t n = last>first ? last-first : 0;
+        Vector<__StringItem> items = Vector<__StringItem>::static_construct(n);
+        for (size_t i=0; i<n; ++i) {
+            __StringItem item = {(const unsigned char*)first[i], strlen(first[i]), i};
+            items.push_back(item);
+        }
+        __string_sort(items.begin(), n);
+        for (size_t i=0; i<n; ++i) first[i] = (const char*)items[i].str;
+    }
+    inline void string_sort(char** first, char** last) 
+        { string_sort((const char**)first, (const char**)last); }
+
+    // 字符串排序：对[first, last)的string进行（可含'\0'）
+    // 排好下标后沿置换的环用string::swap()就位，每个串只交换、不拷贝
+    inline void string_sort(string* first, string* last) {
+        size_t n = last>first ? last-first : 0;
+        Vector<__StringItem> items = Vector<__StringItem>::static_construct(n);
+        for (size_t i=0; i<n; ++i) {
+            __StringItem item = {(const unsigned char*)first[i].data(), first[i].size(), i};
+            items.push_back(item);
+        }
+        __string_sort(items.begin(), n);
+        Vector<char> done(n, 0);
+        for (size_t i=0; i<n; ++i) {
+            if (done[i]) continue;
+            size_t cur = i;
+            while (items[cur].idx != i) {                   // first[cur]应换成原来的first[items[cur].idx]
+                first[cur].swap(first[items[cur].idx]);
+                done[cur] = 1;
+                cur = items[cur].idx;
+            }
+            done[cur] = 1;
+        }
+    }
+};
 
 
 #endif // __SORT__
\ No newline at end of file
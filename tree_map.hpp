@@ -1,44 +1,169 @@
+/* tree_map.hpp
+ * 【树状映射】基于红黑树的有序映射，增/删/查最坏O(logn)，按键的升序遍历
+ * STL当中 <map> 部分内容的简化版，可作有序索引：lower_bound()/upper_bound()/equal_range()做范围查询
+ * 批量操作：from_sorted()由有序序列O(n)建树，split()/join()按键拆分/拼接，merge()/difference_update()做并集/差集，
+ * 都是直接挪动节点（见rb_tree.hpp）
+ */
 #ifndef __TREE_MAP__
 #define __TREE_MAP__
 #include <initializer_list>
-#include "alloc.hpp"    // ...
-#include "traits.hpp"   // ...
-#include "utils.hpp"    // ...
+#include <iostream>
+#include "alloc.hpp"
+#include "utils.hpp"
 #include "rb_tree.hpp"
 using namespace std;
 
 
-// 树状映射节点
-template <class Key, class Value>
-struct __TreeMapNode: public __RBTreeNode<Key> { Value value; };
-// 迭代器...
+// """树状映射"""
+template <class Key, class Value, class KeyCompare = Compare<Key>, class Alloc = SecondAlloc>
+class TreeMap: public __RBTree<__TreeMapNode<Key, Value>, Key, KeyCompare, Alloc> {
 
+public:     // 【类型定义】
+    typedef Pair<Key, Value>    value_type;
+    typedef size_t              size_type;
+    typedef ptrdiff_t           difference_type;
+    typedef __TreeMapNode<Key, Value>   Node;
+    typedef __RBTree<Node, Key, KeyCompare, Alloc> base;
+    typedef typename base::iterator     iterator;
 
-// """..."""
-template <class Key, class Value, class KeyCompare = Compare<Key>, class Alloc = SecondAlloc>
-class TreeMap: public __RBTree<Key, KeyCompare, Alloc> {
-public:
-    void insert(const Key& key, const Value& value) {
-        _insert(_root, key);
-    }
-// public:     // 【类型定义】
-//     typedef Pair<Key, Value>    value_type;         // pointer? reference?
-//     typedef size_t              size_type;
-//     typedef ptrdiff_t           difference_type;
-//     typedef __TreeMapNode<Key, Value>   Node;
-//     typedef Allocator<Node, Alloc>      node_allocator;
-//     static const bool red   = true;
-//     static const bool black = false;
-
-// private:    // 【成员变量】
-//     Node*       _root;
-//     size_type   _count;
-
-// public:     // 【构造/析构函数】
-//     TreeMap() {}
-};
+public:     // 【构造函数】
+    TreeMap() {}
+    TreeMap(initializer_list<value_type> init_list) {
+        for (const auto& item : init_list)
+            insert(item.first, item.second);
+    }
+
+public:     // 【Basic Accessor】最小/最大的节点【须非空】
+    Node& front()   const { return *static_cast<Node*>(this->_header.left); }
+    Node& back()    const { return *static_cast<Node*>(this->_header.right); }
 
+public:     // 【增、改、查】
+    // 插入键值对，键已存在则覆盖其值
+    void insert(const Key& key, const Value& value)
+        { this->_insert_node(key)->value = value; }
+    // 键不存在时插入Value()
+    Value& operator[](const Key& key)
+        { return this->_insert_node(key)->value; }
+    const Value& operator[](const Key& key) const {
+        const Node* node = this->_find_node(key);
+        if (!node) {
+            cerr << "warning: " << "key not found in TreeMap(at " << this << ")!" << endl;
+            static const Value default_value = Value();
+            return default_value;
+        }
+        return node->value;
+    }
+    iterator find(const Key& key) const {
+        Node* node = this->_find_node(key);
+        return node ? iterator(node) : this->end();
+    }
+    bool contains(const Key& key)    const { return this->_find_node(key) != nullptr; }
+    size_type count(const Key& key)  const { return this->_find_node(key) ? 1 : 0; }
+    // 第一个键>=key / >key的位置，[lower_bound(lo), upper_bound(hi))即键在[lo, hi]内的全部节点
+    iterator lower_bound(const Key& key) const { return iterator(this->_lower_bound(key)); }
+    iterator upper_bound(const Key& key) const { return iterator(this->_upper_bound(key)); }
+    Pair<iterator, iterator> equal_range(const Key& key) const
+        { return Pair<iterator, iterator>(lower_bound(key), upper_bound(key)); }
+    // 透明查找：KeyCompare声明了is_transparent时，可直接以const char*/StringView等查找，不构造临时Key
+    template <class K, class = typename __TransparentKey<KeyCompare, KeyCompare, K>::type>
+    iterator find(const K& key) const {
+        Node* node = this->_find_node(key);
+        return node ? iterator(node) : this->end();
+    }
+    template <class K, class = typename __TransparentKey<KeyCompare, KeyCompare, K>::type>
+    bool contains(const K& key)      const { return this->_find_node(key) != nullptr; }
+    template <class K, class = typename __TransparentKey<KeyCompare, KeyCompare, K>::type>
+    size_type count(const K& key)    const { return this->_find_node(key) ? 1 : 0; }
+    template <class K, class = typename __TransparentKey<KeyCompare, KeyCompare, K>::type>
+    iterator lower_bound(const K& key) const { return iterator(this->_lower_bound(key)); }
+    template <class K, class = typename __TransparentKey<KeyCompare, KeyCompare, K>::type>
+    iterator upper_bound(const K& key) const { return iterator(this->_upper_bound(key)); }
+
+public:     // 【批量查找】一组键交错下降、预取下一层节点，让多个cache miss重叠【一批上千个键、树远大于缓存时效果最好】
+    // out[i]即键keys[i]对应值的指针，不存在则为nullptr；返回找到的个数
+    size_type find_batch(const Key* keys, size_type n, Value** out) const {
+        size_type found = 0;
+        this->_find_batch(keys, n, [&](size_type i, Node* node) {
+            out[i] = node ? &node->value : nullptr;
+            found += node != nullptr;
+        });
+        return found;
+    }
+    template <class K, class = typename __TransparentKey<KeyCompare, KeyCompare, K>::type>
+    size_type find_batch(const K* keys, size_type n, Value** out) const {
+        size_type found = 0;
+        this->_find_batch(keys, n, [&](size_type i, Node* node) {
+            out[i] = node ? &node->value : nullptr;
+            found += node != nullptr;
+        });
+        return found;
+    }
+
+public:     // 【顺序统计】都是O(logn)，用于排名、分位数
+    // 键<key的个数，即key在升序中的排名（从0数起）
+    size_type rank(const Key& key) const { return this->_rank(key); }
+    // 第k小（从0数起）的节点，k>=size()则为end()
+    iterator select(size_type k) const { return iterator(this->_select(k)); }
+    // 键在[lo, hi]内的个数
+    size_type count_range(const Key& lo, const Key& hi) const { return this->_count_range(lo, hi); }
+    template <class K, class = typename __TransparentKey<KeyCompare, KeyCompare, K>::type>
+    size_type rank(const K& key) const { return this->_rank(key); }
+    template <class K, class = typename __TransparentKey<KeyCompare, KeyCompare, K>::type>
+    size_type count_range(const K& lo, const K& hi) const { return this->_count_range(lo, hi); }
+
+public:     // 【删】
+    size_type erase(const Key& key) { return this->_erase_key(key); }
+    // 删除position处的节点，返回其后继【其余迭代器都不失效】
+    iterator erase(iterator position) {
+        iterator next = position;
+        ++next;
+        this->_erase_node(position.cur);
+        return next;
+    }
+
+public:     // 【批量操作】
+    // 由键严格升序的键值对序列[first, last)建树，O(n)；不是严格升序则退化为逐个插入（键相同时取后者的值）
+    template <class Iterator>
+    static TreeMap from_sorted(Iterator first, Iterator last) {
+        TreeMap tree_map;
+        bool sorted = tree_map._assign_sorted(first, last,
+            [](const value_type& item) -> const Key& { return item.first; },
+            [](const value_type& item) {
+                Node* node = base::_make_node(item.first);
+                node->value = item.second;
+                return node;
+            });
+        if (!sorted) {
+            cerr << "warning: " << "input of TreeMap::from_sorted() is not strictly ascending, inserted one by one!" << endl;
+            for (; first != last; ++first) tree_map.insert((*first).first, (*first).second);
+        }
+        return tree_map;
+    }
+    // 拆分：键>=key的节点移到返回的TreeMap中，本树只留下键<key的，O(logn)
+    TreeMap split(const Key& key) {
+        TreeMap right;
+        this->_split_off(key, right);
+        return right;
+    }
+    // 拼接：right的节点全部移到本树之后（right随之为空），right的键须都大于本树的键，O(logn)
+    void join(TreeMap& right) {
+        if (!this->_concat(right))
+            cerr << "warning: " << "keys to join are not all greater than those of TreeMap(at " << this << ")!" << endl;
+    }
+    // 并集：other的节点全部并入本树（other随之为空），键相同时取other的值
+    // O(mlog(n/m+1))，m、n为两棵树中较小、较大的节点数
+    void merge(TreeMap& other) { this->_merge(other); }
+    // 差集：删掉也在other中的键，O(mlog(n/m+1))
+    void difference_update(const TreeMap& other) { this->_difference_update(other); }
+};
 
+// cout << tree_map;
+template <class Key, class Value, class KeyCompare, class Alloc>
+ostream& operator<<(ostream& out, const TreeMap<Key, Value, KeyCompare, Alloc>& tree_map) {
+    out << "{ ";
+    for (const auto& node : tree_map) out << node.key << ": " << node.value << ", ";
+    return out << "}";
+}
 
 
-#endif // __TREE_MAP__
\ No newline at end of file
+#endif // __TREE_MAP__
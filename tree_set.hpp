@@ -0,0 +1,134 @@
+/* tree_set.hpp
+ * 【树状集合】基于红黑树的有序集合，增/删/查最坏O(logn)，按升序遍历
+ * STL当中 <set> 部分内容的简化版
+ * 批量操作：from_sorted()由有序序列O(n)建树，split()/join()按键拆分/拼接，merge()/difference_update()做并集/差集，
+ * 都是直接挪动节点（见rb_tree.hpp）
+ */
+#ifndef __TREE_SET__
+#define __TREE_SET__
+#include <initializer_list>
+#include <iostream>
+#include "alloc.hpp"
+#include "utils.hpp"
+#include "rb_tree.hpp"
+using namespace std;
+
+
+// """树状集合"""
+template <class Key, class KeyCompare = Compare<Key>, class Alloc = SecondAlloc>
+class TreeSet: public __RBTree<__TreeSetNode<Key>, Key, KeyCompare, Alloc> {
+
+public:     // 【类型定义】
+    typedef Key                 value_type;
+    typedef size_t              size_type;
+    typedef ptrdiff_t           difference_type;
+    typedef __TreeSetNode<Key>  Node;
+    typedef __RBTree<Node, Key, KeyCompare, Alloc> base;
+    typedef typename base::iterator     iterator;
+
+public:     // 【构造函数】
+    TreeSet() {}
+    TreeSet(initializer_list<Key> init_list) {
+        for (const auto& key : init_list) insert(key);
+    }
+
+public:     // 【Basic Accessor】最小/最大的键【须非空】
+    const Key& front()  const { return static_cast<Node*>(this->_header.left)->key; }
+    const Key& back()   const { return static_cast<Node*>(this->_header.right)->key; }
+
+public:     // 【增、查】
+    // 插入key，返回是否是新插入的（已存在则返回false）
+    bool insert(const Key& key) {
+        bool inserted;
+        this->_insert_node(key, inserted);
+        return inserted;
+    }
+    iterator find(const Key& key) const {
+        Node* node = this->_find_node(key);
+        return node ? iterator(node) : this->end();
+    }
+    bool contains(const Key& key)    const { return this->_find_node(key) != nullptr; }
+    size_type count(const Key& key)  const { return this->_find_node(key) ? 1 : 0; }
+    // 第一个键>=key / >key的位置
+    iterator lower_bound(const Key& key) const { return iterator(this->_lower_bound(key)); }
+    iterator upper_bound(const Key& key) const { return iterator(this->_upper_bound(key)); }
+    Pair<iterator, iterator> equal_range(const Key& key) const
+        { return Pair<iterator, iterator>(lower_bound(key), upper_bound(key)); }
+    // 透明查找：KeyCompare声明了is_transparent时，可直接以const char*/StringView等查找，不构造临时Key
+    template <class K, class = typename __TransparentKey<KeyCompare, KeyCompare, K>::type>
+    iterator find(const K& key) const {
+        Node* node = this->_find_node(key);
+        return node ? iterator(node) : this->end();
+    }
+    template <class K, class = typename __TransparentKey<KeyCompare, KeyCompare, K>::type>
+    bool contains(const K& key)      const { return this->_find_node(key) != nullptr; }
+    template <class K, class = typename __TransparentKey<KeyCompare, KeyCompare, K>::type>
+    size_type count(const K& key)    const { return this->_find_node(key) ? 1 : 0; }
+    template <class K, class = typename __TransparentKey<KeyCompare, KeyCompare, K>::type>
+    iterator lower_bound(const K& key) const { return iterator(this->_lower_bound(key)); }
+    template <class K, class = typename __TransparentKey<KeyCompare, KeyCompare, K>::type>
+    iterator upper_bound(const K& key) const { return iterator(this->_upper_bound(key)); }
+
+public:     // 【顺序统计】都是O(logn)，用于排名、分位数
+    // 键<key的个数，即key在升序中的排名（从0数起）
+    size_type rank(const Key& key) const { return this->_rank(key); }
+    // 第k小（从0数起）的键，k>=size()则为end()
+    iterator select(size_type k) const { return iterator(this->_select(k)); }
+    // 键在[lo, hi]内的个数
+    size_type count_range(const Key& lo, const Key& hi) const { return this->_count_range(lo, hi); }
+    template <class K, class = typename __TransparentKey<KeyCompare, KeyCompare, K>::type>
+    size_type rank(const K& key) const { return this->_rank(key); }
+    template <class K, class = typename __TransparentKey<KeyCompare, KeyCompare, K>::type>
+    size_type count_range(const K& lo, const K& hi) const { return this->_count_range(lo, hi); }
+
+public:     // 【删】
+    size_type erase(const Key& key) { return this->_erase_key(key); }
+    // 删除position处的节点，返回其后继【其余迭代器都不失效】
+    iterator erase(iterator position) {
+        iterator next = position;
+        ++next;
+        this->_erase_node(position.cur);
+        return next;
+    }
+
+public:     // 【批量操作】
+    // 由严格升序的键序列[first, last)建树，O(n)；不是严格升序则退化为逐个插入
+    template <class Iterator>
+    static TreeSet from_sorted(Iterator first, Iterator last) {
+        TreeSet tree_set;
+        bool sorted = tree_set._assign_sorted(first, last,
+            [](const Key& key) -> const Key& { return key; },
+            [](const Key& key) { return base::_make_node(key); });
+        if (!sorted) {
+            cerr << "warning: " << "input of TreeSet::from_sorted() is not strictly ascending, inserted one by one!" << endl;
+            for (; first != last; ++first) tree_set.insert(*first);
+        }
+        return tree_set;
+    }
+    // 拆分：>=key的键移到返回的TreeSet中，本集合只留下<key的，O(logn)
+    TreeSet split(const Key& key) {
+        TreeSet right;
+        this->_split_off(key, right);
+        return right;
+    }
+    // 拼接：right的节点全部移到本集合之后（right随之为空），right的键须都大于本集合的键，O(logn)
+    void join(TreeSet& right) {
+        if (!this->_concat(right))
+            cerr << "warning: " << "keys to join are not all greater than those of TreeSet(at " << this << ")!" << endl;
+    }
+    // 并集：other的节点全部并入本集合（other随之为空），O(mlog(n/m+1))，m、n为两者中较小、较大的大小
+    void merge(TreeSet& other) { this->_merge(other); }
+    // 差集：删掉也在other中的键，O(mlog(n/m+1))
+    void difference_update(const TreeSet& other) { this->_difference_update(other); }
+};
+
+// cout << tree_set;
+template <class Key, class KeyCompare, class Alloc>
+ostream& operator<<(ostream& out, const TreeSet<Key, KeyCompare, Alloc>& tree_set) {
+    out << "{ ";
+    for (const auto& node : tree_set) out << node.key << ", ";
+    return out << "}";
+}
+
+
+#endif // __TREE_SET__
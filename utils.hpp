@@ -5,80 +5,246 @@
 #ifndef __UTILITIES__
 #define __UTILITIES__
 #include <iostream> // ostream
-#include <cstring>  // strcmp
+#include <cstring>  // strcmp, memcpy
+#include <cstdint>  // uint64_t
+#include <ctime>    // time, clock
+#include <string>   // string
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+#if !defined(__GNUC__) && !defined(__clang__) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>  // _mm_prefetch
+#endif
 #include "traits.hpp"
 using namespace std;
 
 
+// """StringView —— 只读的字符串切片（首指针 + 长度），不拥有内存 [C++17 string_view]"""
+// 用于以const char*、大缓冲区中的一段等查找以string为键的容器，不必为每次查找构造临时的string
+struct StringView {
+    const char* ptr;
+    size_t      len;
+    StringView(): ptr(""), len(0) {}
+    StringView(const char* str): ptr(str), len(strlen(str)) {}
+    StringView(const char* str, size_t length): ptr(str), len(length) {}
+    StringView(const string& str): ptr(str.data()), len(str.size()) {}
+#if __cplusplus >= 201703L
+    StringView(std::string_view str): ptr(str.data()), len(str.size()) {}
+    operator std::string_view() const { return std::string_view(ptr, len); }
+#endif
+    const char* data()  const { return ptr; }
+    size_t size()       const { return len; }
+    bool empty()        const { return len == 0; }
+    char operator[](size_t i) const { return ptr[i]; }
+    string to_string()  const { return string(ptr, len); }
+    StringView substr(size_t pos, size_t n = size_t(-1)) const {
+        if (pos > len) pos = len;
+        return StringView(ptr+pos, n < len-pos ? n : len-pos);
+    }
+    // 按unsigned char逐字节比较，与string::compare()一致
+    int compare(StringView other) const {
+        int c = memcmp(ptr, other.ptr, len < other.len ? len : other.len);
+        return c != 0 ? c : (len > other.len) - (len < other.len);
+    }
+    bool operator==(StringView other) const { return len == other.len && memcmp(ptr, other.ptr, len) == 0; }
+    bool operator!=(StringView other) const { return !(*this == other); }
+    bool operator<(StringView other)  const { return compare(other) < 0; }
+    bool operator>(StringView other)  const { return compare(other) > 0; }
+};
+inline ostream& operator<<(ostream& out, StringView str) { return out.write(str.data(), str.size()); }
+
+
+// """软件预取"""
+// 提示CPU提前把addr所在的缓存行读入缓存，不等待、不会出错（addr无效也无妨）
+// 批量查找时先为一批键发出预取，再逐个解析，让多个cache miss同时在路上
+inline void __prefetch(const void* addr) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(addr);
+#elif defined(_M_X64) || defined(_M_IX86)
+    _mm_prefetch((const char*)addr, _MM_HINT_T0);
+#else
+    (void)addr;
+#endif
+}
+
+
+// """哈希函数核心"""
+// 参考wyhash：每次读入8字节，两个64位数相乘取128位结果，高64位^低64位（mum），一次乘法即可充分混合
+// 长串每步处理48字节（三路并行的mum），16字节以内的短串只需两次mum
+static const uint64_t __hash_secret[4] = { 0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL,
+                                           0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL };
+// a*b的128位结果，低64位存回a、高64位存回b
+inline void __hash_mum(uint64_t& a, uint64_t& b) {
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = (__uint128_t)a * b;
+    a = (uint64_t)r;  b = (uint64_t)(r >> 64);
+#else   // 没有128位整数时拆成32位的四个部分积
+    uint64_t ha=a>>32, hb=b>>32, la=(uint32_t)a, lb=(uint32_t)b;
+    uint64_t rh=ha*hb, rm0=ha*lb, rm1=hb*la, rl=la*lb, t=rl+(rm0<<32), c=t<rl;
+    uint64_t lo=t+(rm1<<32);  c+=lo<t;
+    a = lo;  b = rh+(rm0>>32)+(rm1>>32)+c;
+#endif
+}
+inline uint64_t __hash_mix(uint64_t a, uint64_t b) { __hash_mum(a, b);  return a ^ b; }
+inline uint64_t __hash_read8(const unsigned char* p) { uint64_t v;  memcpy(&v, p, 8);  return v; }
+inline uint64_t __hash_read4(const unsigned char* p) { uint32_t v;  memcpy(&v, p, 4);  return v; }
+// [key, key+len)的哈希值
+inline uint64_t __hash_bytes(const void* key, size_t len, uint64_t seed = 0) {
+    const unsigned char* p = (const unsigned char*)key;
+    seed ^= __hash_mix(seed ^ __hash_secret[0], __hash_secret[1]);
+    uint64_t a, b;
+    if (len <= 16) {
+        if (len >= 4) {         // 首尾各取两个4字节（可重叠）
+            a = (__hash_read4(p) << 32) | __hash_read4(p + ((len>>3)<<2));
+            b = (__hash_read4(p+len-4) << 32) | __hash_read4(p+len-4 - ((len>>3)<<2));
+        }
+        else if (len > 0) {     // 1~3字节：首、中、尾三个字节
+            a = ((uint64_t)p[0] << 16) | ((uint64_t)p[len>>1] << 8) | p[len-1];
+            b = 0;
+        }
+        else a = b = 0;
+    }
+    else {
+        size_t i = len;
+        if (i > 48) {
+            uint64_t see1=seed, see2=seed;
+            do {
+                seed = __hash_mix(__hash_read8(p)    ^ __hash_secret[1], __hash_read8(p+8)  ^ seed);
+                see1 = __hash_mix(__hash_read8(p+16) ^ __hash_secret[2], __hash_read8(p+24) ^ see1);
+                see2 = __hash_mix(__hash_read8(p+32) ^ __hash_secret[3], __hash_read8(p+40) ^ see2);
+                p += 48;  i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = __hash_mix(__hash_read8(p) ^ __hash_secret[1], __hash_read8(p+8) ^ seed);
+            p += 16;  i -= 16;
+        }
+        a = __hash_read8(p+i-16);   // 最后16字节（可与前面重叠）
+        b = __hash_read8(p+i-8);
+    }
+    a ^= __hash_secret[1];
+    b ^= seed;
+    __hash_mum(a, b);
+    return __hash_mix(a ^ __hash_secret[0] ^ len, b ^ __hash_secret[1]);
+}
+// 整数的哈希值：一次mum，连续的整数也会被打散到全部64位
+inline uint64_t __hash_int(uint64_t key, uint64_t seed = 0)
+    { return __hash_mix(key ^ seed ^ __hash_secret[0], __hash_secret[1]); }
+// 两个哈希值的组合（Pair<>等）
+inline uint64_t __hash_combine(uint64_t h1, uint64_t h2)
+    { return __hash_mix(h1 ^ __hash_secret[2], h2 ^ __hash_secret[3]); }
+// 浮点数的哈希值：+0.0与-0.0相等、所有NaN都视为同一个，必须先规整再按位哈希
+inline uint64_t __hash_double(double key, uint64_t seed = 0) {
+    if (key == 0) key = 0;                      // -0.0 => +0.0
+    uint64_t bits;
+    if (key != key) bits = 0x7ff8000000000000ULL;   // NaN => 标准的quiet NaN
+    else memcpy(&bits, &key, sizeof(double));
+    return __hash_int(bits, seed);
+}
+// 每个进程一个随机的种子（地址随机化 + 启动时间）
+inline uint64_t __hash_process_seed() {
+    static const uint64_t seed = __hash_int((uint64_t)(size_t)&__hash_secret ^ (uint64_t)time(nullptr),
+                                            (uint64_t)clock() ^ (uint64_t)(size_t)&seed);
+    return seed;
+}
+
+
 // """HashCode —— 输入对象，返回size_t"""
 // 【无论什么编译器，size_t都足以覆盖全部指针地址】
 // 【注意：未偏特化的HashCode什么也不做！！！】
 template <class Type> 
 struct HashCode {};
-// HashCode<字符串> —— 原本还应加上<const char*>的偏特化，不过这个可实例时自行调整模板
+// HashCode<字符串> —— char*/const char*与string对相同内容的哈希值相同
 template<> struct HashCode<char*> {
-    size_t operator()(const char* key) const { 
-        size_t hash_code = 0;
-        for (; *key; ++key)  // 把字符串看作一个31进制的数
-            hash_code = hash_code * 31 + *key;
-        return hash_code;
-    }
+    size_t operator()(const char* key) const { return (size_t)__hash_bytes(key, strlen(key)); }
 };
+template<> struct HashCode<const char*> {
+    size_t operator()(const char* key) const { return (size_t)__hash_bytes(key, strlen(key)); }
+};
+// HashCode<string>是“透明”的（is_transparent）：string、const char*、StringView都转为StringView再哈希，
+// 同样内容的哈希值相同，容器可直接以const char*/StringView查找
 template<> struct HashCode<string> {
-    size_t operator()(const string& key) const { 
-        size_t hash_code = 0;
-        for (const auto& tmp : key)
-            hash_code = hash_code * 31 + tmp;
-        return hash_code;
-    }
+    typedef void is_transparent;
+    size_t operator()(StringView key) const { return (size_t)__hash_bytes(key.data(), key.size()); }
 };
-// HashCode<小于等于size_t的整型> —— 返回自己即可
+template<> struct HashCode<StringView> {
+    typedef void is_transparent;
+    size_t operator()(StringView key) const { return (size_t)__hash_bytes(key.data(), key.size()); }
+};
+// HashCode<整型> —— 不能直接返回自己：连续的整数在2的幂长的表里只用到低位，步长为2^k的整数会全部冲突
 template<> struct HashCode<char> {
-    size_t operator()(char key) const { return (size_t)key; }
+    size_t operator()(char key) const { return (size_t)__hash_int((uint64_t)key); }
 };
 template<> struct HashCode<signed char> {
-    size_t operator()(signed char key) const { return (size_t)key; }  
+    size_t operator()(signed char key) const { return (size_t)__hash_int((uint64_t)key); }
 };
 template<> struct HashCode<unsigned char> {
-    size_t operator()(unsigned char key) const { return (size_t)key; }  
+    size_t operator()(unsigned char key) const { return (size_t)__hash_int((uint64_t)key); }
 };
 template<> struct HashCode<short> {
-    size_t operator()(short key) const { return (size_t)key; }
+    size_t operator()(short key) const { return (size_t)__hash_int((uint64_t)key); }
 };
 template<> struct HashCode<unsigned short> {
-    size_t operator()(unsigned short key) const { return (size_t)key; }
+    size_t operator()(unsigned short key) const { return (size_t)__hash_int((uint64_t)key); }
 };
-template<> struct HashCode<int> {  // java中int固定32位，其哈希函数整体逻辑为(int_obj & 0x7fffffff) ^ ((unsigned)int_obj >> 16)
-    size_t operator()(int key) const { return (size_t)key; }
+template<> struct HashCode<int> {
+    size_t operator()(int key) const { return (size_t)__hash_int((uint64_t)key); }
 };
 template<> struct HashCode<unsigned> {
-    size_t operator()(unsigned key) const { return (size_t)key; }
+    size_t operator()(unsigned key) const { return (size_t)__hash_int((uint64_t)key); }
 };
 template<> struct HashCode<long> {
-    size_t operator()(long key) const { return (size_t)key; }
+    size_t operator()(long key) const { return (size_t)__hash_int((uint64_t)key); }
 };
 template<> struct HashCode<unsigned long> {
-    size_t operator()(unsigned long key) const { return (size_t)key; }
+    size_t operator()(unsigned long key) const { return (size_t)__hash_int((uint64_t)key); }
 };
-// HashCode<大于等于size_t的整型>
 template<> struct HashCode<long long> {
-    size_t operator()(long long key)         // 后32位 ^ 前32位
-        const { return (size_t)(key ^ ((unsigned long long)key>>32)); }
+    size_t operator()(long long key) const { return (size_t)__hash_int((uint64_t)key); }
 };
 template<> struct HashCode<unsigned long long> {
-    size_t operator()(unsigned long long key)// 后32位 ^ 前32位
-        const { return (size_t)(key ^ (key>>32)); }
+    size_t operator()(unsigned long long key) const { return (size_t)__hash_int((uint64_t)key); }
 };
-// HashCode<浮点型> —— 读作整数即可
+// HashCode<浮点型> —— 规整±0与NaN后按位哈希
 template<> struct HashCode<float> {
-    size_t operator()(float key)  // 无论编译器，uint32_t始终与float位数相同
-        const { return (size_t)(*((uint32_t*)&key)); }
+    size_t operator()(float key) const { return (size_t)__hash_double((double)key); }
 };
 template<> struct HashCode<double> {
-    size_t operator()(double key) // 无论编译器，uint64_t始终与double位数相同
-        const { return (*((uint64_t*)&key)) ^ (*((uint64_t*)&key)>>32); }
+    size_t operator()(double key) const { return (size_t)__hash_double(key); }
 };
 // template<> struct HashCode<long double> {};  // TODO: 有待填坑..........
+// HashCode<指针> —— 按地址哈希
+template <class Type>
+struct HashCode<Type*> {
+    size_t operator()(const Type* key) const { return (size_t)__hash_int((uint64_t)(size_t)key); }
+};
+
+
+// """SeededHashCode —— 带种子的HashCode，抵御哈希洪水"""
+// 默认使用每个进程随机的种子：攻击者无法离线构造出大量冲突的键
+// 字符串的种子直接参与__hash_bytes()；其余类型把HashCode<>的结果与种子再混合一次
+template <class Type>
+struct SeededHashCode {
+    uint64_t seed;
+    SeededHashCode(uint64_t hash_seed = __hash_process_seed()): seed(hash_seed) {}
+    size_t operator()(const Type& key) const { return (size_t)__hash_int(HashCode<Type>()(key), seed); }
+};
+template<> struct SeededHashCode<char*> {
+    uint64_t seed;
+    SeededHashCode(uint64_t hash_seed = __hash_process_seed()): seed(hash_seed) {}
+    size_t operator()(const char* key) const { return (size_t)__hash_bytes(key, strlen(key), seed); }
+};
+template<> struct SeededHashCode<const char*> {
+    uint64_t seed;
+    SeededHashCode(uint64_t hash_seed = __hash_process_seed()): seed(hash_seed) {}
+    size_t operator()(const char* key) const { return (size_t)__hash_bytes(key, strlen(key), seed); }
+};
+template<> struct SeededHashCode<string> {
+    uint64_t seed;
+    SeededHashCode(uint64_t hash_seed = __hash_process_seed()): seed(hash_seed) {}
+    size_t operator()(const string& key) const { return (size_t)__hash_bytes(key.data(), key.size(), seed); }
+};
 
 
 // """Compare —— a==b返回0，a>b返回int>0，a<b返回int<0【参考java的obj.compare()】"""
@@ -92,9 +258,23 @@ struct Compare {
 template<> struct Compare<char*> {
     int operator()(const char* a, const char* b) const { return strcmp(a, b); }
 };
+// Compare<string>同样是透明的，两边可以是string、const char*、StringView的任意组合
 template<> struct Compare<string> {
-    int operator()(const string& a, const string& b) const { return strcmp(a.c_str(), b.c_str()); }
-};
+    typedef void is_transparent;
+    int operator()(StringView a, StringView b) const { return a.compare(b); }
+};
+template<> struct Compare<StringView> {
+    typedef void is_transparent;
+    int operator()(StringView a, StringView b) const { return a.compare(b); }
+};
+// 透明查找的SFINAE开关：Hasher与Comp都声明了is_transparent时，__TransparentKey<..., K>::type才存在（即K），
+// 容器据此决定是否提供以任意K查找的模板重载
+template <class... Types> struct __VoidType { typedef void type; };
+template <class Hasher, class Comp, class K, class = void>
+struct __TransparentKey {};
+template <class Hasher, class Comp, class K>
+struct __TransparentKey<Hasher, Comp, K,
+    typename __VoidType<typename Hasher::is_transparent, typename Comp::is_transparent>::type> { typedef K type; };
 // Compare<小于等于int的整型> —— a-b即可
 template<> struct Compare<char> {
     int operator()(char a, char b) const { return (int)(a-b); }
@@ -111,14 +291,31 @@ template<> struct Compare<short> {
 template<> struct Compare<unsigned short> {
     int operator()(unsigned short a, unsigned short b) const { return (int)(a-b); }
 };
+// Compare<int及更大的整型、浮点型> —— a-b可能溢出（或截断），比较两次但无分支
 template<> struct Compare<int> {
-    int operator()(short a, short b) const { return (int)(a-b); }
+    int operator()(int a, int b) const { return (a > b) - (a < b); }
 };
 template<> struct Compare<unsigned int> {
-    int operator()(unsigned int a, unsigned int b) const { return (int)(a-b); }
+    int operator()(unsigned int a, unsigned int b) const { return (a > b) - (a < b); }
+};
+template<> struct Compare<long> {
+    int operator()(long a, long b) const { return (a > b) - (a < b); }
+};
+template<> struct Compare<unsigned long> {
+    int operator()(unsigned long a, unsigned long b) const { return (a > b) - (a < b); }
+};
+template<> struct Compare<long long> {
+    int operator()(long long a, long long b) const { return (a > b) - (a < b); }
+};
+template<> struct Compare<unsigned long long> {
+    int operator()(unsigned long long a, unsigned long long b) const { return (a > b) - (a < b); }
+};
+template<> struct Compare<float> {
+    int operator()(float a, float b) const { return (a > b) - (a < b); }
+};
+template<> struct Compare<double> {
+    int operator()(double a, double b) const { return (a > b) - (a < b); }
 };
-// Compare<大于int的整型> —— TODO: ..........
-// Compare<浮点型> —— TODO: ..........
 
 
 // [STL greater<>]
@@ -184,6 +381,11 @@ struct Compare<Pair<T1, T2>> {
         }
     }
 };
+template<class T1, class T2>
+struct HashCode<Pair<T1, T2>> {
+    size_t operator()(const Pair<T1, T2>& key) const
+        { return (size_t)__hash_combine(HashCode<T1>()(key.first), HashCode<T2>()(key.second)); }
+};
 template <class T1, class T2>
 ostream& operator<<(ostream& out, const Pair<T1, T2>& pr_obj) 
     { return out << "(" << pr_obj.first << ", " << pr_obj.second << ")"; }